@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""Benchmark harness and performance regression check for mips1.x.
+
+Runs every workload several times, records the host wall time, simulation
+speed (simulated instructions per host second), peak RSS and every counter
+printed by ac_behavior(end), and compares them with a stored baseline:
+
+  ./bench.py --save-baseline         # record ../bench_baseline.json
+  ./bench.py                         # compare, exit 1 on a regression
+  ./bench.py --only sha,branchy -n 3
+
+Speed and RSS are compared statistically (Welch t statistic plus a minimum
+relative change), the model counters must match exactly since the
+simulation is deterministic. Run from the mips folder, like the Makefile.
+"""
+
+import argparse
+import glob
+import json
+import math
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+SIMULATOR = './mips1.x'
+BENCH = '../bench'
+
+# name -> (arguments, file that receives stdout or None, files to remove)
+WORKLOADS = {
+    'susan': (['--load=%s/susan/susan' % BENCH, '%s/susan/input_large.pgm' % BENCH,
+               '%s/susan/output_susan.txt' % BENCH], None, []),
+    'jpeg': (['--load=%s/jpeg/djpeg' % BENCH, '%s/jpeg/input_large.jpg' % BENCH],
+             '%s/jpeg/output.ppm' % BENCH, []),
+    'sha': (['--load=%s/sha/sha' % BENCH, '%s/sha/input_large.asc' % BENCH], None, []),
+    'gsm': (['--load=%s/gsm/toast' % BENCH, '%s/gsm/large.au' % BENCH], None,
+            ['%s/gsm/large.au.gsm' % BENCH]),
+    'qsort': (['--load=%s/qsort/qsort_large' % BENCH, '%s/qsort/input_large.dat' % BENCH],
+              None, []),
+    'pointer_chase': (['--load=micro/pointer_chase.mips'], None, []),
+    'stream_copy': (['--load=micro/stream_copy.mips'], None, []),
+    'branchy': (['--load=micro/branchy.mips'], None, []),
+}
+
+# the synthetic kernels of synth.py, once built with make synth (not their
+# one pass twins)
+for path in sorted(glob.glob('micro/synth/*.mips')):
+    if path.endswith('.once.mips'):
+        continue
+    WORKLOADS['synth_' + os.path.basename(path)[:-len('.mips')]] = (['--load=' + path], None, [])
+
+STAT_LINE = re.compile(r'^\s*([A-Za-z][\w /()-]*?)\s*=\s*([-+]?[\d.]+(?:[eE][-+]?\d+)?)\s*$')
+PREDICTOR_LINE = re.compile(r'^- (.+?): \[ (\d+) \] hits and \[ (\d+) \] misses')
+
+
+def parse_stats(output):
+    stats = {}
+    for line in output.splitlines():
+        m = STAT_LINE.match(line)
+        if m:
+            stats[m.group(1).strip()] = float(m.group(2))
+            continue
+        m = PREDICTOR_LINE.match(line)
+        if m:
+            stats[m.group(1) + ' hits'] = float(m.group(2))
+            stats[m.group(1) + ' misses'] = float(m.group(3))
+    return stats
+
+
+def run_once(name):
+    args, stdout_file, cleanup = WORKLOADS[name]
+
+    with tempfile.TemporaryFile() as out, tempfile.TemporaryFile() as err:
+        target = open(stdout_file, 'w+b') if stdout_file else out
+
+        # wait4 instead of communicate() to get the child's own rusage; the
+        # exit status is ignored since mips1.x exits non zero after stop()
+        start = time.perf_counter()
+        proc = subprocess.Popen([SIMULATOR] + args, stdout=target, stderr=err)
+        _, _, usage = os.wait4(proc.pid, 0)
+        wall = time.perf_counter() - start
+        proc.returncode = 0
+
+        # the counters are printed to stdout, after the program output
+        target.seek(0)
+        err.seek(0)
+        text = target.read().decode('latin-1') + '\n' + err.read().decode('latin-1')
+        if stdout_file:
+            target.close()
+
+    for path in cleanup:
+        if os.path.exists(path):
+            os.remove(path)
+
+    stats = parse_stats(text)
+    if 'instructionCount' not in stats:
+        sys.exit('%s: no instructionCount in the simulator output' % name)
+
+    return {
+        'wall': wall,
+        'mips': stats['instructionCount'] / wall / 1e6,
+        'rss_kb': usage.ru_maxrss,
+        'stats': stats,
+    }
+
+
+def summarize(samples):
+    n = len(samples)
+    mean = sum(samples) / n
+    var = sum((x - mean) ** 2 for x in samples) / (n - 1) if n > 1 else 0.0
+    return {'n': n, 'mean': mean, 'sd': math.sqrt(var), 'min': min(samples), 'max': max(samples)}
+
+
+def run_workload(name, runs):
+    results = [run_once(name) for _ in range(runs)]
+    for r in results[1:]:
+        if r['stats'] != results[0]['stats']:
+            print('warning: %s counters differ between runs' % name, file=sys.stderr)
+    return {
+        'wall': summarize([r['wall'] for r in results]),
+        'mips': summarize([r['mips'] for r in results]),
+        'rss_kb': summarize([r['rss_kb'] for r in results]),
+        'stats': results[0]['stats'],
+    }
+
+
+def welch_t(cur, base):
+    se = math.sqrt(cur['sd'] ** 2 / cur['n'] + base['sd'] ** 2 / base['n'])
+    if se == 0:
+        return math.inf if cur['mean'] != base['mean'] else 0.0
+    return (cur['mean'] - base['mean']) / se
+
+
+def compare(name, cur, base, args):
+    failures = []
+
+    # lower speed is worse
+    drop = (base['mips']['mean'] - cur['mips']['mean']) / base['mips']['mean']
+    t = -welch_t(cur['mips'], base['mips'])
+    if drop > args.threshold / 100.0 and t > args.t_critical:
+        failures.append('speed %.3f -> %.3f MIPS (-%.1f%%, t=%.1f)' %
+                        (base['mips']['mean'], cur['mips']['mean'], 100 * drop, t))
+
+    growth = (cur['rss_kb']['mean'] - base['rss_kb']['mean']) / base['rss_kb']['mean']
+    if growth > args.rss_threshold / 100.0:
+        failures.append('peak RSS %d -> %d KB (+%.1f%%)' %
+                        (base['rss_kb']['mean'], cur['rss_kb']['mean'], 100 * growth))
+
+    if not args.allow_stat_changes:
+        for key in sorted(set(cur['stats']) | set(base['stats'])):
+            a, b = base['stats'].get(key), cur['stats'].get(key)
+            if a is None or b is None or abs(a - b) > 1e-9 * max(abs(a), abs(b)):
+                failures.append('counter "%s" %s -> %s' % (key, a, b))
+
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('-n', '--runs', type=int, default=5, help='runs per workload (default 5)')
+    parser.add_argument('--only', help='comma separated workloads (default all)')
+    parser.add_argument('--baseline', default='../bench_baseline.json')
+    parser.add_argument('--save-baseline', action='store_true',
+                        help='store the results as the new baseline instead of comparing')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='minimum speed drop in %% reported as a regression (default 5)')
+    parser.add_argument('--t-critical', type=float, default=2.0,
+                        help='minimum Welch t statistic of a speed regression (default 2.0)')
+    parser.add_argument('--rss-threshold', type=float, default=10.0,
+                        help='maximum peak RSS growth in %% (default 10)')
+    parser.add_argument('--allow-stat-changes', action='store_true',
+                        help='do not fail when the model counters change')
+    args = parser.parse_args()
+
+    names = args.only.split(',') if args.only else list(WORKLOADS)
+    for name in names:
+        if name not in WORKLOADS:
+            parser.error('unknown workload %s (known: %s)' % (name, ', '.join(WORKLOADS)))
+
+    baseline = {}
+    if not args.save_baseline:
+        if os.path.exists(args.baseline):
+            with open(args.baseline) as f:
+                baseline = json.load(f)
+        else:
+            print('no baseline at %s, only measuring' % args.baseline)
+
+    results = {}
+    regressions = 0
+    print('%-14s %10s %8s %10s %10s' % ('workload', 'wall (s)', 'sd', 'MIPS', 'RSS (KB)'))
+    for name in names:
+        cur = run_workload(name, args.runs)
+        results[name] = cur
+        print('%-14s %10.3f %8.3f %10.3f %10d' % (name, cur['wall']['mean'], cur['wall']['sd'],
+                                                   cur['mips']['mean'], cur['rss_kb']['mean']))
+        if name in baseline:
+            for failure in compare(name, cur, baseline[name], args):
+                print('  REGRESSION %s: %s' % (name, failure))
+                regressions += 1
+
+    if args.save_baseline:
+        if os.path.exists(args.baseline):
+            with open(args.baseline) as f:
+                old = json.load(f)
+            old.update(results)
+            results = old
+        with open(args.baseline, 'w') as f:
+            json.dump(results, f, indent=1, sort_keys=True)
+        print('baseline saved to %s' % args.baseline)
+
+    if regressions:
+        print('%d regression(s)' % regressions)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
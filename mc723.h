@@ -21,6 +21,18 @@ typedef struct {
 InstructionContext lastInstruction;
 InstructionContext currentInstruction;
 
+// Uncomment to run the hazard, cache and predictor models on separate
+// threads fed by the simulation thread (see mc723_timing.h)
+//#define DECOUPLED_TIMING
+
+// Address of the instruction being executed (ac_pc already points past it
+// inside the behaviors because of the delay slot). Each timing thread has
+// its own copy, taken from the events it replays.
+#ifdef DECOUPLED_TIMING
+__thread
+#endif
+unsigned int currentPC;
+
 void createContext (int r_dest, int r_read1, int r_read2, InstructionType type);
 
 /************** Cache ****************/
@@ -45,14 +57,35 @@ void createContext (int r_dest, int r_read1, int r_read2, InstructionType type);
 
 // *_BLOCK_OFFSET_BITS must be log2(CACHE_BLOCK_SIZE*4)
 
+// MESI state of a data cache line, only used with more than one core
+enum MesiState {
+  MESI_INVALID = 0,
+  MESI_SHARED,
+  MESI_EXCLUSIVE,
+  MESI_MODIFIED
+};
+
 typedef struct {
     int tag;
     bool valid;
     bool dirty;
+    MesiState state;
+    // invalidated by another core, so the next miss is a coherence miss
+    bool invalidated;
 } CacheEntry;
 
-CacheEntry dataCache[DATA_CACHE_SIZE];
-CacheEntry instructionCache[INSTRUCTION_CACHE_SIZE];
+// Number of simulated cores (mips1 instances in the platform), each with
+// private caches and predictors (see mc723_coherence.h)
+#ifndef CORES
+#define CORES 1
+#endif
+
+CacheEntry coreDataCache[CORES][DATA_CACHE_SIZE];
+CacheEntry coreInstructionCache[CORES][INSTRUCTION_CACHE_SIZE];
+
+// Caches of the core being simulated
+CacheEntry *dataCache = coreDataCache[0];
+CacheEntry *instructionCache = coreInstructionCache[0];
 
 /*************************************************/
 
@@ -101,8 +134,34 @@ unsigned long long twoBitHitCount;
 unsigned long long twoBitMissCount;
 
 // States
-OneBitPredictor oneBitPredictor[1 << K];
-TwoBitPredictor twoBitPredictor[1 << K];
+OneBitPredictor coreOneBitPredictor[CORES][1 << K];
+TwoBitPredictor coreTwoBitPredictor[CORES][1 << K];
+
+// Predictors of the core being simulated
+OneBitPredictor *oneBitPredictor = coreOneBitPredictor[0];
+TwoBitPredictor *twoBitPredictor = coreTwoBitPredictor[0];
+
+/*************************************************/
+
+/************** Profiling ****************/
+
+// Events attributed to PCs and functions by the profilers
+enum ProfileEvent {
+  PE_INSTRUCTION,
+  PE_DATA_MISS,
+  PE_INSTRUCTION_MISS,
+  PE_BRANCH_MISPREDICT,
+  PE_HAZARD,
+  PE_EVENTS
+};
+
+const char *profileEventName[PE_EVENTS] = {
+  "instructions",
+  "data cache misses",
+  "instruction cache misses",
+  "branch mispredictions (two-bits)",
+  "load-use hazards"
+};
 
 /*************************************************/
 
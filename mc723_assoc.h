@@ -0,0 +1,233 @@
+#ifndef _MC723_ASSOC_H
+#define _MC723_ASSOC_H
+
+#include <vector>
+
+/************** Set-associative cache ****************/
+
+// Configurable cache (sets x ways, write-back, write-allocate) used by the
+// studies that run next to the direct-mapped dataCache and see the same
+// accesses. Only tags and replacement metadata are kept, the data itself
+// stays in the ArchC memory.
+
+enum AssocPolicy {
+  ASSOC_LRU,
+  ASSOC_SRRIP,      // static re-reference interval prediction
+  ASSOC_BRRIP,      // bimodal RRIP: most fills predicted distant
+  ASSOC_DRRIP,      // SRRIP or BRRIP, chosen by set dueling
+  ASSOC_SHIP,       // SRRIP with the insertion predicted by the PC signature
+  ASSOC_LFU,
+  ASSOC_OPT,        // Belady: needs the next use of every access
+  ASSOC_POLICIES
+};
+
+const char *assocPolicyName[ASSOC_POLICIES] = {
+  "LRU", "SRRIP", "BRRIP", "DRRIP", "SHiP", "LFU", "OPT"
+};
+
+// 2-bit re-reference prediction values
+#define ASSOC_RRPV_MAX 3
+// BRRIP inserts with a long (not distant) prediction once every N fills
+#define ASSOC_BRRIP_EPSILON 32
+// DRRIP leader sets per policy and selector width
+#define ASSOC_DUEL_LEADERS 4
+#define ASSOC_PSEL_BITS 10
+// SHiP signature history counter table
+#define ASSOC_SHCT_BITS 14
+#define ASSOC_SHCT_MAX 7
+#define ASSOC_SHIP_SIGNATURE(PC) ((((PC) >> 2) ^ ((PC) >> (2 + ASSOC_SHCT_BITS))) & ((1 << ASSOC_SHCT_BITS) - 1))
+
+#define ASSOC_NEVER 0xFFFFFFFF
+
+typedef struct {
+  unsigned int tag;
+  bool valid;
+  bool dirty;
+  unsigned long long lastUse;   // LRU stamp
+  unsigned char rrpv;           // RRIP and SHiP
+  bool reused;                  // SHiP: hit since the fill
+  unsigned short signature;     // SHiP
+  unsigned int count;           // LFU
+  unsigned int nextUse;         // OPT: index of the next access, or ASSOC_NEVER
+} AssocLine;
+
+typedef struct {
+  AssocPolicy policy;
+  unsigned int sets, ways;
+  unsigned int setBits, lineBits;
+  std::vector<AssocLine> lines;   // set s is lines[s * ways .. s * ways + ways - 1]
+  unsigned long long clock;
+
+  unsigned int brripFills;
+  unsigned int duelStride;        // DRRIP: a leader set of each policy every duelStride sets
+  int psel;                       // DRRIP: high when SRRIP misses more
+  std::vector<unsigned char> shct;
+
+  unsigned long long accesses;
+  unsigned long long misses;
+  unsigned long long writebacks;
+} AssocCache;
+
+// lines and ways must be powers of two
+void assocInit (AssocCache &c, unsigned int lines, unsigned int ways, unsigned int lineBits,
+                AssocPolicy policy = ASSOC_LRU) {
+  c.policy = policy;
+  c.ways = ways;
+  c.sets = lines / ways;
+  c.setBits = 0;
+  while ((1u << c.setBits) < c.sets)
+    c.setBits++;
+  c.lineBits = lineBits;
+
+  AssocLine empty = { 0, false, false, 0, ASSOC_RRPV_MAX, false, 0, 0, ASSOC_NEVER };
+  c.lines.assign(lines, empty);
+  c.clock = 0;
+
+  c.brripFills = 0;
+  unsigned int leaders = c.sets / 4 < ASSOC_DUEL_LEADERS ? c.sets / 4 : ASSOC_DUEL_LEADERS;
+  c.duelStride = leaders ? c.sets / leaders : 0;
+  c.psel = 1 << (ASSOC_PSEL_BITS - 1);
+  c.shct.assign(policy == ASSOC_SHIP ? 1 << ASSOC_SHCT_BITS : 0, 1);
+  c.accesses = c.misses = c.writebacks = 0;
+}
+
+inline unsigned int assocSet (const AssocCache &c, unsigned int addr) {
+  return (addr >> c.lineBits) & (c.sets - 1);
+}
+
+inline unsigned int assocTag (const AssocCache &c, unsigned int addr) {
+  return addr >> (c.lineBits + c.setBits);
+}
+
+inline AssocLine *assocWays (AssocCache &c, unsigned int set) {
+  return &c.lines[set * c.ways];
+}
+
+// Way holding tag in set, or -1
+int assocFind (AssocCache &c, unsigned int set, unsigned int tag) {
+  AssocLine *way = assocWays(c, set);
+  for (unsigned int w = 0; w < c.ways; w++)
+    if (way[w].valid && way[w].tag == tag)
+      return w;
+  return -1;
+}
+
+// Insertion policy of set: leader sets follow their own, the others PSEL
+AssocPolicy assocRrip (const AssocCache &c, unsigned int set) {
+  if (c.policy != ASSOC_DRRIP)
+    return c.policy;
+  if (c.duelStride && set % c.duelStride == 0)
+    return ASSOC_SRRIP;
+  if (c.duelStride && set % c.duelStride == c.duelStride / 2)
+    return ASSOC_BRRIP;
+  return c.psel >= 1 << (ASSOC_PSEL_BITS - 1) ? ASSOC_BRRIP : ASSOC_SRRIP;
+}
+
+// An invalid way if there is one, otherwise the one the policy evicts
+int assocVictim (AssocCache &c, unsigned int set) {
+  AssocLine *way = assocWays(c, set);
+  for (unsigned int w = 0; w < c.ways; w++)
+    if (!way[w].valid)
+      return w;
+
+  int victim = 0;
+  switch (c.policy) {
+  case ASSOC_SRRIP:
+  case ASSOC_BRRIP:
+  case ASSOC_DRRIP:
+  case ASSOC_SHIP:
+    // the first distant line, aging the whole set until there is one
+    for (;;) {
+      for (unsigned int w = 0; w < c.ways; w++)
+        if (way[w].rrpv == ASSOC_RRPV_MAX)
+          return w;
+      for (unsigned int w = 0; w < c.ways; w++)
+        way[w].rrpv++;
+    }
+
+  case ASSOC_LFU:
+    for (unsigned int w = 1; w < c.ways; w++)
+      if (way[w].count < way[victim].count
+          || (way[w].count == way[victim].count && way[w].lastUse < way[victim].lastUse))
+        victim = w;
+    return victim;
+
+  case ASSOC_OPT:
+    for (unsigned int w = 1; w < c.ways; w++)
+      if (way[w].nextUse > way[victim].nextUse)
+        victim = w;
+    return victim;
+
+  default:
+    for (unsigned int w = 1; w < c.ways; w++)
+      if (way[w].lastUse < way[victim].lastUse)
+        victim = w;
+    return victim;
+  }
+}
+
+/*
+ * Looks up addr, filling the line on a miss, and returns the way that
+ * holds it afterwards; hit tells whether it was already there. pc feeds
+ * the SHiP signature and nextUse the OPT decisions (the index of the next
+ * access to the same line).
+ */
+int assocAccess (AssocCache &c, unsigned int addr, bool write, bool &hit,
+                 unsigned int pc = 0, unsigned int nextUse = ASSOC_NEVER) {
+  unsigned int set = assocSet(c, addr);
+  unsigned int tag = assocTag(c, addr);
+  AssocLine *way = assocWays(c, set);
+
+  c.accesses++;
+  int w = assocFind(c, set, tag);
+  hit = w >= 0;
+  if (hit) {
+    way[w].rrpv = 0;
+    way[w].count++;
+    if (c.policy == ASSOC_SHIP && !way[w].reused) {
+      way[w].reused = true;
+      if (c.shct[way[w].signature] < ASSOC_SHCT_MAX)
+        c.shct[way[w].signature]++;
+    }
+  } else {
+    c.misses++;
+    // misses in the leader sets move the selector
+    if (c.policy == ASSOC_DRRIP && c.duelStride) {
+      if (set % c.duelStride == 0 && c.psel < (1 << ASSOC_PSEL_BITS) - 1)
+        c.psel++;
+      else if (set % c.duelStride == c.duelStride / 2 && c.psel > 0)
+        c.psel--;
+    }
+
+    w = assocVictim(c, set);
+    if (way[w].valid && way[w].dirty)
+      c.writebacks++;
+    // a line evicted without reuse trains its signature down
+    if (c.policy == ASSOC_SHIP && way[w].valid && !way[w].reused && c.shct[way[w].signature] > 0)
+      c.shct[way[w].signature]--;
+
+    way[w].tag = tag;
+    way[w].valid = true;
+    way[w].dirty = false;
+    way[w].count = 1;
+    way[w].reused = false;
+    way[w].rrpv = ASSOC_RRPV_MAX - 1;
+    if (assocRrip(c, set) == ASSOC_BRRIP && ++c.brripFills % ASSOC_BRRIP_EPSILON != 0)
+      way[w].rrpv = ASSOC_RRPV_MAX;
+    if (c.policy == ASSOC_SHIP) {
+      way[w].signature = ASSOC_SHIP_SIGNATURE(pc);
+      if (c.shct[way[w].signature] == 0)
+        way[w].rrpv = ASSOC_RRPV_MAX;
+    }
+  }
+
+  way[w].lastUse = ++c.clock;
+  way[w].nextUse = nextUse;
+  if (write)
+    way[w].dirty = true;
+  return w;
+}
+
+/*************************************************/
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef _MC723_CALLGRAPH_H
+#define _MC723_CALLGRAPH_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "mc723.h"
+#include "mc723_elf.h"
+
+/************** Call graph profiler ****************/
+
+// Uncomment to attribute instructions, misses, hazards and mispredictions
+// to functions and call edges using a shadow call stack
+//#define CALLGRAPH_PROFILER
+
+// Collapsed stacks ("main;foo;bar 1234" per line) for flamegraph.pl
+#define CALLGRAPH_FOLDED_FILE "../callgraph.folded"
+// Event used as the weight of each stack in the folded file
+#define CALLGRAPH_FOLDED_EVENT PE_INSTRUCTION
+
+// Deeper frames (deep recursion) are charged to the deepest context
+#define CALLGRAPH_MAX_DEPTH 128
+
+// How many functions and call edges are listed in the report
+#define CALLGRAPH_TOP_N 20
+
+#if CORES > 1 && defined(CALLGRAPH_PROFILER)
+#error "CALLGRAPH_PROFILER keeps a single shadow stack and cannot follow more than one core"
+#endif
+
+// Node of the calling context tree: one per distinct call path
+typedef struct {
+  unsigned int func;
+  int parent;
+  int depth;
+  unsigned long long calls;
+  unsigned long long count[PE_EVENTS];
+} CallNode;
+
+// Shadow stack entry
+typedef struct {
+  unsigned int returnAddr;
+  int node;
+} CallFrame;
+
+std::vector<CallNode> callNodes;
+std::map<unsigned long long, int> callChildren;
+std::vector<CallFrame> callStack;
+CallNode *callCurrent;
+
+// Calls and returns take effect after the delay slot, which still belongs
+// to the caller (2 = armed by the jump, 1 = delay slot done)
+int callPendingStage;
+bool callPendingIsReturn;
+unsigned int callPendingFunc;
+unsigned int callPendingReturnAddr;
+
+#ifdef CALLGRAPH_PROFILER
+#define CALLGRAPH_RECORD(EVENT, N) (callCurrent->count[EVENT] += (N))
+#else
+#define CALLGRAPH_RECORD(EVENT, N)
+#endif
+
+int callgraphNode (int parent, unsigned int func) {
+  unsigned long long key = ((unsigned long long) parent << 32) | func;
+  std::map<unsigned long long, int>::iterator it = callChildren.find(key);
+  if (it != callChildren.end())
+    return it->second;
+
+  CallNode node;
+  node.func = func;
+  node.parent = parent;
+  node.depth = parent < 0 ? 0 : callNodes[parent].depth + 1;
+  node.calls = 0;
+  for (int e = 0; e < PE_EVENTS; e++)
+    node.count[e] = 0;
+
+  // push_back may move the nodes, so callCurrent must be taken again
+  int current = callCurrent == NULL ? -1 : (int) (callCurrent - &callNodes[0]);
+  callNodes.push_back(node);
+  if (current >= 0)
+    callCurrent = &callNodes[current];
+
+  int id = (int) callNodes.size() - 1;
+  callChildren[key] = id;
+  return id;
+}
+
+void callgraphInit (unsigned int entry) {
+  callNodes.clear();
+  callChildren.clear();
+  callStack.clear();
+  callCurrent = NULL;
+  callPendingStage = 0;
+
+  callNodes.reserve(4096);
+  int root = callgraphNode(-1, entry);
+  callCurrent = &callNodes[root];
+
+  CallFrame frame;
+  frame.returnAddr = 0;
+  frame.node = root;
+  callStack.push_back(frame);
+}
+
+void callgraphCall (unsigned int func, unsigned int returnAddr) {
+  callPendingStage = 2;
+  callPendingIsReturn = false;
+  callPendingFunc = func;
+  callPendingReturnAddr = returnAddr;
+}
+
+void callgraphReturn (unsigned int target) {
+  callPendingStage = 2;
+  callPendingIsReturn = true;
+  callPendingReturnAddr = target;
+}
+
+void callgraphApply () {
+  int top = callStack.back().node;
+
+  if (!callPendingIsReturn) {
+    int node = top;
+    if (callNodes[top].depth < CALLGRAPH_MAX_DEPTH)
+      node = callgraphNode(top, callPendingFunc);
+
+    CallFrame frame;
+    frame.returnAddr = callPendingReturnAddr;
+    frame.node = node;
+    callStack.push_back(frame);
+    callNodes[node].calls++;
+    callCurrent = &callNodes[node];
+    return;
+  }
+
+  // Unwind to the frame that returns to the target, which also covers
+  // longjmp and functions that do not return through their own jr $ra.
+  // A jr $ra that matches no frame is just an indirect jump.
+  for (int i = (int) callStack.size() - 1; i > 0; i--) {
+    if (callStack[i].returnAddr == callPendingReturnAddr) {
+      callStack.resize(i);
+      callCurrent = &callNodes[callStack.back().node];
+      return;
+    }
+  }
+}
+
+// Called once per instruction, before the instruction is counted
+inline void callgraphInstruction () {
+  if (callPendingStage != 0 && --callPendingStage == 0)
+    callgraphApply();
+  callCurrent->count[PE_INSTRUCTION]++;
+}
+
+/*-------------------------- Report --------------------------*/
+
+std::string callgraphName (unsigned int func) {
+  const ElfSymbol *sym = findElfSymbol(func);
+  if (sym != NULL && sym->addr == func)
+    return sym->name;
+
+  char buf[256];
+  return symbolizeAddress(func, buf, sizeof(buf));
+}
+
+void callgraphWriteFolded () {
+  FILE *fp = fopen(CALLGRAPH_FOLDED_FILE, "w");
+  if (fp == NULL) {
+    fprintf(stderr, "callgraph: could not write %s\n", CALLGRAPH_FOLDED_FILE);
+    return;
+  }
+
+  std::vector<std::string> names(callNodes.size());
+  for (size_t i = 0; i < callNodes.size(); i++)
+    names[i] = callgraphName(callNodes[i].func);
+
+  std::vector<int> path;
+  for (size_t i = 0; i < callNodes.size(); i++) {
+    if (callNodes[i].count[CALLGRAPH_FOLDED_EVENT] == 0)
+      continue;
+
+    path.clear();
+    for (int n = (int) i; n >= 0; n = callNodes[n].parent)
+      path.push_back(n);
+
+    for (int p = (int) path.size() - 1; p >= 0; p--)
+      fprintf(fp, "%s%s", names[path[p]].c_str(), p == 0 ? " " : ";");
+    fprintf(fp, "%llu\n", callNodes[i].count[CALLGRAPH_FOLDED_EVENT]);
+  }
+  fclose(fp);
+}
+
+typedef struct {
+  unsigned long long calls;
+  unsigned long long count[PE_EVENTS];
+} CallTotals;
+
+typedef std::map<unsigned long long, CallTotals> CallTotalsMap;
+
+void callgraphAdd (CallTotals &totals, const CallNode &node, const unsigned long long *count) {
+  totals.calls += node.calls;
+  for (int e = 0; e < PE_EVENTS; e++)
+    totals.count[e] += count[e];
+}
+
+// Under recursion the same caller -> callee edge appears again below itself;
+// only the outermost occurrence is credited, as its inclusive counts already
+// hold the deeper ones
+bool callgraphOuterEdge (int i) {
+  unsigned int caller = callNodes[callNodes[i].parent].func;
+  for (int n = callNodes[i].parent; callNodes[n].parent >= 0; n = callNodes[n].parent)
+    if (callNodes[n].func == callNodes[i].func && callNodes[callNodes[n].parent].func == caller)
+      return false;
+  return true;
+}
+
+bool callTotalsMore (const std::pair<unsigned long long, CallTotals> &a,
+                     const std::pair<unsigned long long, CallTotals> &b) {
+  return a.second.count[PE_INSTRUCTION] > b.second.count[PE_INSTRUCTION];
+}
+
+void callgraphPrintTable (const char *title, const CallTotalsMap &table, bool edges) {
+  std::vector<std::pair<unsigned long long, CallTotals> > rows(table.begin(), table.end());
+  size_t top = std::min(rows.size(), (size_t) CALLGRAPH_TOP_N);
+  std::partial_sort(rows.begin(), rows.begin() + top, rows.end(), callTotalsMore);
+
+  printf("\n- %s:\n", title);
+  printf("  %12s %12s %10s %10s %10s %10s  %s\n", "instructions", "calls",
+         "dmiss", "imiss", "mispred", "hazards", edges ? "caller -> callee" : "function");
+  for (size_t i = 0; i < top; i++) {
+    const CallTotals &t = rows[i].second;
+    std::string name = callgraphName((unsigned int) rows[i].first);
+    if (edges)
+      name = callgraphName((unsigned int) (rows[i].first >> 32)) + " -> " + name;
+    printf("  %12llu %12llu %10llu %10llu %10llu %10llu  %s\n", t.count[PE_INSTRUCTION], t.calls,
+           t.count[PE_DATA_MISS], t.count[PE_INSTRUCTION_MISS], t.count[PE_BRANCH_MISPREDICT],
+           t.count[PE_HAZARD], name.c_str());
+  }
+}
+
+void callgraphReport () {
+  // inclusive counts: children always come after their parent in callNodes
+  std::vector<CallNode> inclusive(callNodes);
+  for (int i = (int) inclusive.size() - 1; i > 0; i--) {
+    int parent = inclusive[i].parent;
+    if (parent >= 0)
+      for (int e = 0; e < PE_EVENTS; e++)
+        inclusive[parent].count[e] += inclusive[i].count[e];
+  }
+
+  CallTotalsMap self, edges;
+  CallTotals zero;
+  zero.calls = 0;
+  for (int e = 0; e < PE_EVENTS; e++)
+    zero.count[e] = 0;
+
+  for (size_t i = 0; i < callNodes.size(); i++) {
+    const CallNode &node = callNodes[i];
+
+    CallTotalsMap::iterator it = self.insert(std::make_pair((unsigned long long) node.func, zero)).first;
+    callgraphAdd(it->second, node, node.count);
+
+    if (node.parent >= 0) {
+      unsigned long long key = ((unsigned long long) callNodes[node.parent].func << 32) | node.func;
+      it = edges.insert(std::make_pair(key, zero)).first;
+      callgraphAdd(it->second, node, callgraphOuterEdge((int) i) ? inclusive[i].count : zero.count);
+    }
+  }
+
+  printf("\n\n*********************** CALL GRAPH ******************************\n");
+  printf("- contexts: %u, max depth: %d\n", (unsigned int) callNodes.size(), CALLGRAPH_MAX_DEPTH);
+  callgraphPrintTable("Functions (self)", self, false);
+  callgraphPrintTable("Call edges (inclusive)", edges, true);
+  printf("*****************************************************************\n");
+
+  callgraphWriteFolded();
+}
+
+/*************************************************/
+
+#endif
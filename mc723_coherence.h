@@ -0,0 +1,297 @@
+#ifndef _MC723_COHERENCE_H
+#define _MC723_COHERENCE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "mc723.h"
+
+/************** Multi-core / MESI coherence ****************/
+
+// With CORES > 1 (mc723.h) every mips1 instance of the platform gets its
+// own instruction cache, data cache, predictors and hazard context. The
+// data caches are kept coherent by a MESI protocol over a snooping bus.
+//
+// The behaviors of all instances share the same globals, so the instance
+// being simulated is found from the ISA object and the pointers in
+// mc723.h are switched to its private state when it changes.
+
+// 0: every core has its own memory (each mips1 instance of
+//    mc723_platform.cpp gets a private DM), so equal addresses on two
+//    cores are different data and the bus only carries each core's misses
+// 1: the cores share one memory (same address = same data); only valid on
+//    a platform that binds every instance to one storage, which
+//    mc723_platform.cpp does not
+#define COHERENCE_SHARED_MEMORY 0
+
+#if CORES > 1 && COHERENCE_SHARED_MEMORY
+#error "COHERENCE_SHARED_MEMORY needs the cores bound to one storage, but every mips1 instance has its own DM"
+#endif
+
+#if CORES > 1 && defined(DECOUPLED_TIMING)
+#error "DECOUPLED_TIMING supports a single core"
+#endif
+
+// The counters of mips1_isa.cpp; they keep the totals of all the cores
+extern unsigned long long hazardCount;
+extern unsigned long long dataCacheMiss;
+extern unsigned long long memAccessCount;
+extern unsigned long long instructionCacheMiss;
+extern unsigned long long instructionCount;
+
+// Share of the global counters of one core
+typedef struct {
+  unsigned long long instructions;
+  unsigned long long memAccesses;
+  unsigned long long dataMisses;
+  unsigned long long instructionMisses;
+  unsigned long long hazards;
+  unsigned long long branches;
+  unsigned long long alwaysTakenMisses;
+  unsigned long long neverTakenMisses;
+  unsigned long long oneBitMisses;
+  unsigned long long twoBitMisses;
+} CoreCounters;
+
+typedef struct {
+  unsigned long long busReads;        // BusRd: read miss
+  unsigned long long busReadExclusive; // BusRdX: write miss
+  unsigned long long busUpgrades;     // BusUpgr: write hit on a shared line
+  unsigned long long flushes;         // modified line supplied to another core
+  unsigned long long invalidationsSent;
+  unsigned long long invalidationsReceived;
+  unsigned long long coherenceMisses;
+  CoreCounters counters;
+} CoreStats;
+
+typedef struct {
+  const void *isa;
+  bool finished;
+  InstructionContext lastInstruction;
+  InstructionContext currentInstruction;
+  CoreStats stats;
+} Core;
+
+Core cores[CORES];
+int coreCount;
+int currentCore;
+
+// The global counters when they were last charged to currentCore
+CoreCounters coreMark;
+
+CoreCounters coreReadCounters () {
+  CoreCounters now;
+  now.instructions = instructionCount;
+  now.memAccesses = memAccessCount;
+  now.dataMisses = dataCacheMiss;
+  now.instructionMisses = instructionCacheMiss;
+  now.hazards = hazardCount;
+  now.branches = twoBitHitCount + twoBitMissCount;
+  now.alwaysTakenMisses = alwaysTakenMissCount;
+  now.neverTakenMisses = neverTakenMissCount;
+  now.oneBitMisses = oneBitMissCount;
+  now.twoBitMisses = twoBitMissCount;
+  return now;
+}
+
+// Charges what the global counters grew since the last call to currentCore;
+// done when the core changes, not on every event
+void coreAccount () {
+  CoreCounters now = coreReadCounters();
+  CoreCounters &c = cores[currentCore].stats.counters;
+  c.instructions += now.instructions - coreMark.instructions;
+  c.memAccesses += now.memAccesses - coreMark.memAccesses;
+  c.dataMisses += now.dataMisses - coreMark.dataMisses;
+  c.instructionMisses += now.instructionMisses - coreMark.instructionMisses;
+  c.hazards += now.hazards - coreMark.hazards;
+  c.branches += now.branches - coreMark.branches;
+  c.alwaysTakenMisses += now.alwaysTakenMisses - coreMark.alwaysTakenMisses;
+  c.neverTakenMisses += now.neverTakenMisses - coreMark.neverTakenMisses;
+  c.oneBitMisses += now.oneBitMisses - coreMark.oneBitMisses;
+  c.twoBitMisses += now.twoBitMisses - coreMark.twoBitMisses;
+  coreMark = now;
+}
+
+// Called by begin after it resets the global counters
+void coreResetMark () {
+  coreMark = coreReadCounters();
+}
+
+void coreSelect (int core) {
+  if (core == currentCore)
+    return;
+
+  coreAccount();
+
+  cores[currentCore].lastInstruction = lastInstruction;
+  cores[currentCore].currentInstruction = currentInstruction;
+
+  currentCore = core;
+  dataCache = coreDataCache[core];
+  instructionCache = coreInstructionCache[core];
+  oneBitPredictor = coreOneBitPredictor[core];
+  twoBitPredictor = coreTwoBitPredictor[core];
+  lastInstruction = cores[core].lastInstruction;
+  currentInstruction = cores[core].currentInstruction;
+}
+
+// Called from begin, once per instance, before its state is initialized
+void coreRegister (const void *isa) {
+  if (coreCount == CORES) {
+    fprintf(stderr, "coherence: more than %d cores, increase CORES in mc723.h\n", CORES);
+    exit(EXIT_FAILURE);
+  }
+
+  int core = coreCount++;
+  cores[core].isa = isa;
+  cores[core].finished = false;
+  cores[core].currentInstruction.type = UNITIALIZED;
+  cores[core].lastInstruction.type = UNITIALIZED;
+
+  CoreStats zero = { 0, 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } };
+  cores[core].stats = zero;
+
+  for (int i = 0; i < DATA_CACHE_SIZE; i++) {
+    coreDataCache[core][i].state = MESI_INVALID;
+    coreDataCache[core][i].invalidated = false;
+  }
+  coreSelect(core);
+}
+
+// Called once per instruction; the cores are few, so a linear search
+inline void coreSwitch (const void *isa) {
+  if (cores[currentCore].isa == isa)
+    return;
+  for (int c = 0; c < coreCount; c++)
+    if (cores[c].isa == isa) {
+      coreSelect(c);
+      return;
+    }
+}
+
+// Returns true when the last running core finishes, with the counters of
+// every core up to date
+bool coreFinish (const void *isa) {
+  coreSwitch(isa);
+  cores[currentCore].finished = true;
+  for (int c = 0; c < coreCount; c++)
+    if (!cores[c].finished)
+      return false;
+  coreAccount();
+  return true;
+}
+
+/*
+ * Snoops the other data caches for a line. A read leaves the other copies
+ * shared (a modified one is flushed first); a write invalidates them.
+ * Returns whether another cache had the line.
+ */
+bool coherenceSnoop (int row, int tag, bool write) {
+  bool shared = false;
+
+#if COHERENCE_SHARED_MEMORY
+  for (int c = 0; c < coreCount; c++) {
+    if (c == currentCore)
+      continue;
+
+    CacheEntry &line = coreDataCache[c][row];
+    if (line.state == MESI_INVALID || line.tag != tag)
+      continue;
+
+    shared = true;
+    if (line.state == MESI_MODIFIED) {
+      cores[currentCore].stats.flushes++;
+      line.dirty = false;
+    }
+
+    if (write) {
+      line.state = MESI_INVALID;
+      line.valid = false;
+      line.invalidated = true;
+      cores[currentCore].stats.invalidationsSent++;
+      cores[c].stats.invalidationsReceived++;
+    } else {
+      line.state = MESI_SHARED;
+    }
+  }
+#endif
+
+  return shared;
+}
+
+// Called by verifyCacheRead before it updates the line
+void coherenceRead (int row, int tag) {
+  CacheEntry &line = dataCache[row];
+  if (line.state != MESI_INVALID && line.tag == tag)
+    return;
+
+  if (line.invalidated && line.tag == tag)
+    cores[currentCore].stats.coherenceMisses++;
+
+  cores[currentCore].stats.busReads++;
+  line.state = coherenceSnoop(row, tag, false) ? MESI_SHARED : MESI_EXCLUSIVE;
+  line.invalidated = false;
+}
+
+// Called by verifyCacheWrite before it updates the line
+void coherenceWrite (int row, int tag) {
+  CacheEntry &line = dataCache[row];
+
+  if (line.state != MESI_INVALID && line.tag == tag) {
+    if (line.state == MESI_SHARED) {
+      cores[currentCore].stats.busUpgrades++;
+      coherenceSnoop(row, tag, true);
+    }
+  } else {
+    if (line.invalidated && line.tag == tag)
+      cores[currentCore].stats.coherenceMisses++;
+    cores[currentCore].stats.busReadExclusive++;
+    coherenceSnoop(row, tag, true);
+  }
+
+  line.state = MESI_MODIFIED;
+  line.invalidated = false;
+}
+
+void coherenceReport () {
+  unsigned int lineSize = 1 << DATA_BLOCK_OFFSET_SIZE_BITS;
+  CoreStats total = { 0, 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } };
+
+  printf("\n\n************************ COHERENCE ******************************\n");
+  printf("- %d cores, MESI snooping bus, %s memory\n", coreCount,
+         COHERENCE_SHARED_MEMORY ? "shared" : "private");
+  printf("  %4s %12s %10s %10s %10s %10s %10s %10s %10s\n", "core", "instructions", "BusRd",
+         "BusRdX", "BusUpgr", "flushes", "inv sent", "inv recv", "coh miss");
+  for (int c = 0; c < coreCount; c++) {
+    const CoreStats &s = cores[c].stats;
+    printf("  %4d %12llu %10llu %10llu %10llu %10llu %10llu %10llu %10llu\n", c, s.counters.instructions,
+           s.busReads, s.busReadExclusive, s.busUpgrades, s.flushes, s.invalidationsSent,
+           s.invalidationsReceived, s.coherenceMisses);
+    total.busReads += s.busReads;
+    total.busReadExclusive += s.busReadExclusive;
+    total.busUpgrades += s.busUpgrades;
+    total.flushes += s.flushes;
+    total.invalidationsSent += s.invalidationsSent;
+    total.coherenceMisses += s.coherenceMisses;
+  }
+
+  unsigned long long transactions = total.busReads + total.busReadExclusive + total.busUpgrades + total.flushes;
+  unsigned long long bytes = (total.busReads + total.busReadExclusive + total.flushes) * lineSize;
+  printf("- bus transactions: %llu (%llu data bytes), invalidations: %llu, coherence misses: %llu\n",
+         transactions, bytes, total.invalidationsSent, total.coherenceMisses);
+
+  printf("- counters per core (the global ones above are their sums):\n");
+  printf("  %4s %12s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n", "core", "instructions", "mem acc",
+         "data miss", "inst miss", "hazards", "branches", "taken", "not taken", "one-bit", "two-bits");
+  for (int c = 0; c < coreCount; c++) {
+    const CoreCounters &n = cores[c].stats.counters;
+    printf("  %4d %12llu %10llu %10llu %10llu %10llu %10llu %10llu %10llu %10llu %10llu\n", c,
+           n.instructions, n.memAccesses, n.dataMisses, n.instructionMisses, n.hazards, n.branches,
+           n.alwaysTakenMisses, n.neverTakenMisses, n.oneBitMisses, n.twoBitMisses);
+  }
+  printf("  (taken, not taken, one-bit and two-bits are the mispredictions of each predictor)\n");
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
@@ -0,0 +1,441 @@
+#ifndef _MC723_COMPRESS_H
+#define _MC723_COMPRESS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "mc723.h"
+#include "mc723_assoc.h"
+
+/************** Compressed data cache ****************/
+
+// Uncomment to run compressed copies of the data cache that see the line
+// contents in DM: base-delta-immediate (BDI) and frequent pattern (FPC)
+// compression with a variable number of lines per set, next to
+// uncompressed caches of the same and of twice the capacity
+//#define COMPRESSED_CACHE
+
+// Capacity of the uncompressed cache the compressed ones are built on
+#define COMPRESS_LINES DATA_CACHE_SIZE
+#define COMPRESS_LINE_BITS DATA_BLOCK_OFFSET_SIZE_BITS
+#define COMPRESS_WAYS 4
+
+// Tags per set are COMPRESS_TAG_FACTOR * COMPRESS_WAYS, and the data of a
+// set is COMPRESS_WAYS lines of COMPRESS_SEGMENTS segments each
+#define COMPRESS_TAG_FACTOR 2
+#define COMPRESS_SEGMENTS 8
+
+// Extra cycles of a hit on a compressed line
+#define COMPRESS_BDI_LATENCY 1
+#define COMPRESS_FPC_LATENCY 5
+
+#define COMPRESS_LINE_BYTES (1 << COMPRESS_LINE_BITS)
+#define COMPRESS_LINE_WORDS (COMPRESS_LINE_BYTES / 4)
+
+#if COMPRESS_LINE_BITS < 4 || COMPRESS_LINE_BITS > 8
+#error "COMPRESS_LINE_BITS must be from 4 (one 16 byte vector) to 8"
+#endif
+#if COMPRESS_LINE_BYTES % COMPRESS_SEGMENTS != 0
+#error "COMPRESS_SEGMENTS must divide the line size"
+#endif
+#if defined(COMPRESSED_CACHE) && defined(DECOUPLED_TIMING)
+#error "COMPRESSED_CACHE reads the line contents in DM at the access, before the timing threads would see it"
+#endif
+
+/*
+ * The cache is called from the load and store behaviors with the effective
+ * address, before a store writes DM. A fill reads its line from DM and
+ * compresses it; a store leaves the line stale, and the next access to it
+ * compresses it again (a line that grows evicts others from its set). A
+ * set holds up to COMPRESS_TAG_FACTOR times more lines than the plain
+ * cache, as long as their segments fit; misses evict in LRU order until
+ * the new line has a tag and its segments.
+ *
+ * Both compressibility checks run on 16 byte vectors with the GCC vector
+ * extensions. BDI tries an 8, 4 and 2 byte base with 1, 2 or 4 byte
+ * deltas, each value taking either the base or zero as its base (one mask
+ * bit per value), plus the all-zeros and repeated-value lines. FPC gives
+ * each word a 3 bit prefix and the smallest of its patterns; runs of up to
+ * 8 zero words share one prefix.
+ */
+
+enum CompressScheme {
+  COMPRESS_BDI,
+  COMPRESS_FPC,
+  COMPRESS_SCHEMES
+};
+
+const char *compressSchemeName[COMPRESS_SCHEMES] = { "BDI", "FPC" };
+const int compressLatency[COMPRESS_SCHEMES] = { COMPRESS_BDI_LATENCY, COMPRESS_FPC_LATENCY };
+
+typedef unsigned long long CompressVec64 __attribute__ ((vector_size (16)));
+typedef unsigned int CompressVec32 __attribute__ ((vector_size (16)));
+typedef unsigned short CompressVec16 __attribute__ ((vector_size (16)));
+
+// The line as values of each width, in guest (big-endian) order
+typedef struct {
+  unsigned long long v64[COMPRESS_LINE_BYTES / 8] __attribute__ ((aligned (16)));
+  unsigned int v32[COMPRESS_LINE_WORDS] __attribute__ ((aligned (16)));
+  unsigned short v16[COMPRESS_LINE_BYTES / 2] __attribute__ ((aligned (16)));
+} CompressData;
+
+template <class Memory>
+void compressRead (Memory &dm, unsigned int line, CompressData &d) {
+  unsigned int addr = line << COMPRESS_LINE_BITS;
+  for (int i = 0; i < COMPRESS_LINE_WORDS; i++) {
+    d.v32[i] = dm.read(addr + 4 * i);
+    d.v16[2 * i] = d.v32[i] >> 16;
+    d.v16[2 * i + 1] = d.v32[i];
+  }
+  for (int i = 0; i < COMPRESS_LINE_BYTES / 8; i++)
+    d.v64[i] = ((unsigned long long) d.v32[2 * i] << 32) | d.v32[2 * i + 1];
+}
+
+template <class Vec>
+inline Vec compressSplat (unsigned long long x) {
+  Vec v;
+  for (unsigned int i = 0; i < sizeof(Vec) / sizeof(v[0]); i++)
+    v[i] = x;
+  return v;
+}
+
+template <class Vec>
+inline Vec compressSelect (Vec c, Vec a, Vec b) {
+  return (a & c) | (b & ~c);
+}
+
+template <class Vec>
+inline bool compressAllZero (Vec v) {
+  for (unsigned int i = 0; i < sizeof(Vec) / sizeof(v[0]); i++)
+    if (v[i] != 0)
+      return false;
+  return true;
+}
+
+/*
+ * BDI with base size sizeof(T): bytes of the line with deltas of
+ * deltaBytes, or 0 when some value fits neither the base nor zero.
+ */
+template <class T, class Vec>
+unsigned int compressBdiBase (const T *value, unsigned int deltaBytes) {
+  const int n = COMPRESS_LINE_BYTES / sizeof(T);
+  const int lanes = sizeof(Vec) / sizeof(T);
+  T half = (T) 1 << (8 * deltaBytes - 1);
+  T limit = (T) 1 << (8 * deltaBytes);
+
+  // the base is the first value that is not a small immediate
+  T base = 0;
+  for (int i = 0; i < n; i++)
+    if ((T) (value[i] + half) >= limit) {
+      base = value[i];
+      break;
+    }
+
+  Vec vBase = compressSplat<Vec>(base), vHalf = compressSplat<Vec>(half), vLimit = compressSplat<Vec>(limit);
+  Vec bad = compressSplat<Vec>(0);
+  for (int i = 0; i < n; i += lanes) {
+    Vec v = *(const Vec *) &value[i];
+    Vec fitsZero = (Vec) (v + vHalf < vLimit);
+    Vec fitsBase = (Vec) (v - vBase + vHalf < vLimit);
+    bad |= ~(fitsZero | fitsBase);
+  }
+  if (!compressAllZero(bad))
+    return 0;
+  return sizeof(T) + n * deltaBytes + (n + 7) / 8;
+}
+
+unsigned int compressBdi (const CompressData &d) {
+  CompressVec64 any = compressSplat<CompressVec64>(0);
+  CompressVec64 differ = compressSplat<CompressVec64>(0);
+  CompressVec64 first = compressSplat<CompressVec64>(d.v64[0]);
+  for (int i = 0; i < COMPRESS_LINE_BYTES / 8; i += 2) {
+    CompressVec64 v = *(const CompressVec64 *) &d.v64[i];
+    any |= v;
+    differ |= v ^ first;
+  }
+  if (compressAllZero(any))
+    return 1;
+  if (compressAllZero(differ))
+    return 8;
+
+  unsigned int best = COMPRESS_LINE_BYTES, size;
+  for (unsigned int delta = 1; delta < 8; delta *= 2)
+    if ((size = compressBdiBase<unsigned long long, CompressVec64>(d.v64, delta)) && size < best)
+      best = size;
+  for (unsigned int delta = 1; delta < 4; delta *= 2)
+    if ((size = compressBdiBase<unsigned int, CompressVec32>(d.v32, delta)) && size < best)
+      best = size;
+  if ((size = compressBdiBase<unsigned short, CompressVec16>(d.v16, 1)) && size < best)
+    best = size;
+  return best;
+}
+
+unsigned int compressFpc (const CompressData &d) {
+  CompressVec32 zero = compressSplat<CompressVec32>(0);
+  CompressVec32 low = compressSplat<CompressVec32>(0xFFFF);
+  CompressVec32 half4 = compressSplat<CompressVec32>(0x8), limit4 = compressSplat<CompressVec32>(0x10);
+  CompressVec32 half8 = compressSplat<CompressVec32>(0x80), limit8 = compressSplat<CompressVec32>(0x100);
+  CompressVec32 half16 = compressSplat<CompressVec32>(0x8000), limit16 = compressSplat<CompressVec32>(0x10000);
+  CompressVec32 byte = compressSplat<CompressVec32>(0xFF), spread = compressSplat<CompressVec32>(0x01010101);
+  unsigned int bits = 0;
+  unsigned long long zeroMask = 0;
+
+  for (int i = 0; i < COMPRESS_LINE_WORDS; i += 4) {
+    CompressVec32 w = *(const CompressVec32 *) &d.v32[i];
+    CompressVec32 isZero = (CompressVec32) (w == zero);
+    CompressVec32 sign4 = (CompressVec32) (w + half4 < limit4);
+    CompressVec32 sign8 = (CompressVec32) (w + half8 < limit8);
+    CompressVec32 sign16 = (CompressVec32) (w + half16 < limit16);
+    CompressVec32 padded = (CompressVec32) ((w & low) == zero);
+    CompressVec32 bytePair = (CompressVec32) ((((w >> 16) + half8) & low) < limit8)
+                             & (CompressVec32) (((w + half8) & low) < limit8);
+    CompressVec32 repeated = (CompressVec32) (w == (w & byte) * spread);
+
+    // prefix + data bits of each word; zero words are counted as runs below
+    CompressVec32 cost = compressSplat<CompressVec32>(3 + 32);
+    cost = compressSelect(sign16 | padded | bytePair, compressSplat<CompressVec32>(3 + 16), cost);
+    cost = compressSelect(sign8 | repeated, compressSplat<CompressVec32>(3 + 8), cost);
+    cost = compressSelect(sign4, compressSplat<CompressVec32>(3 + 4), cost);
+    cost = compressSelect(isZero, zero, cost);
+    for (int l = 0; l < 4; l++) {
+      bits += cost[l];
+      zeroMask |= (unsigned long long) (isZero[l] & 1) << (i + l);
+    }
+  }
+
+  for (int i = 0, run = 0; i < COMPRESS_LINE_WORDS; i++) {
+    if (zeroMask & (1ull << i)) {
+      if (run == 0)
+        bits += 3 + 3;
+      run = run == 7 ? 0 : run + 1;
+    } else {
+      run = 0;
+    }
+  }
+
+  unsigned int bytes = (bits + 7) / 8;
+  return bytes < COMPRESS_LINE_BYTES ? bytes : COMPRESS_LINE_BYTES;
+}
+
+inline unsigned int compressSegments (unsigned int bytes) {
+  const unsigned int segment = COMPRESS_LINE_BYTES / COMPRESS_SEGMENTS;
+  return (bytes + segment - 1) / segment;
+}
+
+typedef struct {
+  unsigned int tag;
+  bool valid;
+  bool dirty;
+  bool stale;                   // written since it was compressed
+  unsigned char segments;
+  unsigned long long lastUse;
+} CompressLine;
+
+typedef struct {
+  CompressScheme scheme;
+  unsigned int sets, setBits;
+  unsigned int tags;            // per set
+  unsigned int budget;          // segments per set
+  std::vector<CompressLine> lines;
+  std::vector<unsigned int> used;
+  unsigned long long clock;
+  unsigned int resident;
+
+  unsigned long long accesses, misses, writebacks;
+  unsigned long long decompressions;
+  unsigned long long recompressions, growEvictions;
+  unsigned long long residentSum;           // resident lines, summed per access
+  unsigned long long fills, fillBytes;
+  unsigned long long sizeHistogram[COMPRESS_SEGMENTS + 1];
+} CompressCache;
+
+typedef struct {
+  CompressCache cache[COMPRESS_SCHEMES];
+  AssocCache plain;             // same capacity, uncompressed
+  AssocCache plainDouble;       // twice the capacity
+} CompressModel;
+
+CompressModel compress[CORES];
+
+void compressCacheInit (CompressCache &c, CompressScheme scheme) {
+  c.scheme = scheme;
+  c.sets = COMPRESS_LINES / COMPRESS_WAYS;
+  c.setBits = 0;
+  while ((1u << c.setBits) < c.sets)
+    c.setBits++;
+  c.tags = COMPRESS_WAYS * COMPRESS_TAG_FACTOR;
+  c.budget = COMPRESS_WAYS * COMPRESS_SEGMENTS;
+
+  CompressLine empty = { 0, false, false, false, 0, 0 };
+  c.lines.assign(c.sets * c.tags, empty);
+  c.used.assign(c.sets, 0);
+  c.clock = 0;
+  c.resident = 0;
+
+  c.accesses = c.misses = c.writebacks = 0;
+  c.decompressions = c.recompressions = c.growEvictions = 0;
+  c.residentSum = c.fills = c.fillBytes = 0;
+  memset(c.sizeHistogram, 0, sizeof(c.sizeHistogram));
+}
+
+void compressInit (CompressModel &m) {
+  for (int s = 0; s < COMPRESS_SCHEMES; s++)
+    compressCacheInit(m.cache[s], (CompressScheme) s);
+  assocInit(m.plain, COMPRESS_LINES, COMPRESS_WAYS, COMPRESS_LINE_BITS);
+  assocInit(m.plainDouble, 2 * COMPRESS_LINES, COMPRESS_WAYS, COMPRESS_LINE_BITS);
+}
+
+inline unsigned int compressSize (CompressScheme scheme, const CompressData &d) {
+  return scheme == COMPRESS_BDI ? compressBdi(d) : compressFpc(d);
+}
+
+/*
+ * Evicts the LRU lines of set other than keep until there is a free tag
+ * (when needTag) and segments more segments fit.
+ */
+void compressMakeRoom (CompressCache &c, unsigned int set, bool needTag, unsigned int segments, int keep) {
+  CompressLine *way = &c.lines[set * c.tags];
+  for (;;) {
+    int valid = 0, victim = -1;
+    for (unsigned int w = 0; w < c.tags; w++) {
+      if (!way[w].valid)
+        continue;
+      valid++;
+      if ((int) w != keep && (victim < 0 || way[w].lastUse < way[victim].lastUse))
+        victim = w;
+    }
+    if ((!needTag || valid < (int) c.tags) && c.used[set] + segments <= c.budget)
+      return;
+    if (victim < 0)
+      return;
+
+    if (way[victim].dirty)
+      c.writebacks++;
+    c.used[set] -= way[victim].segments;
+    way[victim].valid = false;
+    c.resident--;
+  }
+}
+
+// data is read from DM by the first cache that needs it
+template <class Memory>
+void compressCacheAccess (CompressCache &c, Memory &dm, unsigned int addr, bool write, CompressData &data,
+                          bool &loaded) {
+  unsigned int line = addr >> COMPRESS_LINE_BITS;
+  unsigned int set = line & (c.sets - 1);
+  unsigned int tag = line >> c.setBits;
+  CompressLine *way = &c.lines[set * c.tags];
+
+  c.accesses++;
+  int w = -1;
+  for (unsigned int i = 0; i < c.tags; i++)
+    if (way[i].valid && way[i].tag == tag)
+      w = i;
+
+  if (w >= 0) {
+    if (way[w].stale) {
+      if (!loaded)
+        compressRead(dm, line, data);
+      loaded = true;
+      unsigned int segments = compressSegments(compressSize(c.scheme, data));
+      c.recompressions++;
+      c.used[set] += segments - way[w].segments;
+      way[w].segments = segments;
+      way[w].stale = false;
+      if (c.used[set] > c.budget) {
+        unsigned int before = c.resident;
+        compressMakeRoom(c, set, false, 0, w);
+        c.growEvictions += before - c.resident;
+      }
+    }
+    if (way[w].segments < COMPRESS_SEGMENTS)
+      c.decompressions++;
+  } else {
+    c.misses++;
+    if (!loaded)
+      compressRead(dm, line, data);
+    loaded = true;
+    unsigned int bytes = compressSize(c.scheme, data);
+    unsigned int segments = compressSegments(bytes);
+    compressMakeRoom(c, set, true, segments, -1);
+
+    for (w = 0; way[w].valid; w++)
+      ;
+    way[w].tag = tag;
+    way[w].valid = true;
+    way[w].dirty = false;
+    way[w].stale = false;
+    way[w].segments = segments;
+    c.used[set] += segments;
+    c.resident++;
+    c.fills++;
+    c.fillBytes += bytes;
+    c.sizeHistogram[segments]++;
+  }
+
+  way[w].lastUse = ++c.clock;
+  if (write) {
+    // the store writes DM after this call
+    way[w].dirty = true;
+    way[w].stale = true;
+  }
+  c.residentSum += c.resident;
+}
+
+// Called from the load and store behaviors with the effective address
+template <class Memory>
+void compressAccess (CompressModel &m, Memory &dm, unsigned int addr, bool write) {
+  CompressData data;
+  bool loaded = false, hit;
+  for (int s = 0; s < COMPRESS_SCHEMES; s++)
+    compressCacheAccess(m.cache[s], dm, addr, write, data, loaded);
+  assocAccess(m.plain, addr, write, hit);
+  assocAccess(m.plainDouble, addr, write, hit);
+}
+
+void compressReport () {
+  printf("\n\n******************** COMPRESSED DATA CACHE **********************\n");
+  printf("- %d lines of %d bytes, %d ways: %d tags and %d segments of %d bytes per set\n", COMPRESS_LINES,
+         COMPRESS_LINE_BYTES, COMPRESS_WAYS, COMPRESS_WAYS * COMPRESS_TAG_FACTOR, COMPRESS_WAYS * COMPRESS_SEGMENTS,
+         COMPRESS_LINE_BYTES / COMPRESS_SEGMENTS);
+  for (int core = 0; core < CORES; core++) {
+    CompressModel &m = compress[core];
+    if (m.plain.accesses == 0)
+      continue;
+    if (CORES > 1)
+      printf("core %d:\n", core);
+
+    printf("  %-22s %12s %10s %8s %9s %14s\n", "cache", "misses+wb", "miss rate", "ratio", "capacity",
+           "decompr cycles");
+    const AssocCache *plain[2] = { &m.plain, &m.plainDouble };
+    const char *plainName[2] = { "uncompressed", "uncompressed, 2x size" };
+    for (int p = 0; p < 2; p++)
+      printf("  %-22s %12llu %9.3lf%% %8s %9u\n", plainName[p], plain[p]->misses + plain[p]->writebacks,
+             100.0 * plain[p]->misses / plain[p]->accesses, "", (unsigned int) plain[p]->lines.size());
+
+    for (int s = 0; s < COMPRESS_SCHEMES; s++) {
+      const CompressCache &c = m.cache[s];
+      double capacity = c.accesses ? (double) c.residentSum / c.accesses : 0.0;
+      printf("  %-22s %12llu %9.3lf%% %7.2lfx %9.2lf %14llu\n", compressSchemeName[s], c.misses + c.writebacks,
+             100.0 * c.misses / c.accesses, c.fillBytes ? (double) c.fills * COMPRESS_LINE_BYTES / c.fillBytes : 0.0,
+             capacity, c.decompressions * compressLatency[s]);
+    }
+
+    for (int s = 0; s < COMPRESS_SCHEMES; s++) {
+      const CompressCache &c = m.cache[s];
+      printf("  %s: effective capacity %.2lfx, %llu hits decompressed (+%d cycles each), %llu recompressed "
+             "after stores, %llu evicted by a line that grew\n", compressSchemeName[s],
+             c.accesses ? (double) c.residentSum / c.accesses / COMPRESS_LINES : 0.0, c.decompressions,
+             compressLatency[s], c.recompressions, c.growEvictions);
+      printf("    segments at fill:");
+      for (int n = 1; n <= COMPRESS_SEGMENTS; n++)
+        printf(" %d: %.1lf%%", n, c.fills ? 100.0 * c.sizeHistogram[n] / c.fills : 0.0);
+      printf("\n");
+    }
+  }
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
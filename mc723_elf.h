@@ -0,0 +1,183 @@
+#ifndef _MC723_ELF_H
+#define _MC723_ELF_H
+
+#include <elf.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/************** ELF symbol table ****************/
+
+// Symbols (functions and data objects) of the program loaded with --load=,
+// sorted by address so that a PC or data address can be symbolized with a
+// binary search.
+
+typedef struct {
+  unsigned int addr;
+  unsigned int size;
+  bool isFunction;
+  std::string name;
+} ElfSymbol;
+
+std::vector<ElfSymbol> elfSymbols;
+bool elfSymbolsLoaded = false;
+
+bool elfSymbolLess (const ElfSymbol &a, const ElfSymbol &b) {
+  return a.addr < b.addr;
+}
+
+/*
+ * The ArchC loader does not expose the application file name to the
+ * behaviors, so it is taken back from the simulator command line.
+ */
+std::string findLoadedProgram () {
+  std::string program;
+  FILE *fp = fopen("/proc/self/cmdline", "rb");
+  if (fp == NULL)
+    return program;
+
+  std::string arg;
+  int c;
+  while ((c = fgetc(fp)) != EOF) {
+    if (c != '\0') {
+      arg += (char) c;
+      continue;
+    }
+    if (arg.compare(0, 7, "--load=") == 0)
+      program = arg.substr(7);
+    arg.clear();
+  }
+  fclose(fp);
+  return program;
+}
+
+// mips1 binaries are big-endian, so every field must go through these
+unsigned int elfWord (const unsigned char *p, bool bigEndian) {
+  if (bigEndian)
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+  return (p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+unsigned int elfHalf (const unsigned char *p, bool bigEndian) {
+  if (bigEndian)
+    return (p[0] << 8) | p[1];
+  return (p[1] << 8) | p[0];
+}
+
+void loadElfSymbols () {
+  if (elfSymbolsLoaded)
+    return;
+  elfSymbolsLoaded = true;
+
+  std::string program = findLoadedProgram();
+  FILE *fp = fopen(program.c_str(), "rb");
+  if (fp == NULL) {
+    fprintf(stderr, "elf: could not open '%s' to read symbols\n", program.c_str());
+    return;
+  }
+
+  std::vector<unsigned char> image;
+  unsigned char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    image.insert(image.end(), buf, buf + n);
+  fclose(fp);
+
+  if (image.size() < sizeof(Elf32_Ehdr) || memcmp(&image[0], ELFMAG, SELFMAG) != 0
+      || image[EI_CLASS] != ELFCLASS32) {
+    fprintf(stderr, "elf: '%s' is not a 32-bit ELF file\n", program.c_str());
+    return;
+  }
+
+  bool be = image[EI_DATA] == ELFDATA2MSB;
+  const unsigned char *eh = &image[0];
+  unsigned int shoff = elfWord(eh + offsetof(Elf32_Ehdr, e_shoff), be);
+  unsigned int shentsize = elfHalf(eh + offsetof(Elf32_Ehdr, e_shentsize), be);
+  unsigned int shnum = elfHalf(eh + offsetof(Elf32_Ehdr, e_shnum), be);
+
+  if (shoff + shnum * shentsize > image.size())
+    return;
+
+  for (unsigned int s = 0; s < shnum; s++) {
+    const unsigned char *sh = &image[shoff + s * shentsize];
+    if (elfWord(sh + offsetof(Elf32_Shdr, sh_type), be) != SHT_SYMTAB)
+      continue;
+
+    unsigned int symoff = elfWord(sh + offsetof(Elf32_Shdr, sh_offset), be);
+    unsigned int symsize = elfWord(sh + offsetof(Elf32_Shdr, sh_size), be);
+    unsigned int link = elfWord(sh + offsetof(Elf32_Shdr, sh_link), be);
+    if (link >= shnum)
+      continue;
+
+    const unsigned char *strsh = &image[shoff + link * shentsize];
+    unsigned int stroff = elfWord(strsh + offsetof(Elf32_Shdr, sh_offset), be);
+    unsigned int strsize = elfWord(strsh + offsetof(Elf32_Shdr, sh_size), be);
+    if (symoff + symsize > image.size() || stroff + strsize > image.size())
+      continue;
+
+    for (unsigned int off = 0; off + sizeof(Elf32_Sym) <= symsize; off += sizeof(Elf32_Sym)) {
+      const unsigned char *sym = &image[symoff + off];
+      unsigned int type = ELF32_ST_TYPE(sym[offsetof(Elf32_Sym, st_info)]);
+      if (type != STT_FUNC && type != STT_OBJECT)
+        continue;
+
+      unsigned int name = elfWord(sym + offsetof(Elf32_Sym, st_name), be);
+      if (name >= strsize)
+        continue;
+
+      ElfSymbol entry;
+      entry.addr = elfWord(sym + offsetof(Elf32_Sym, st_value), be);
+      entry.size = elfWord(sym + offsetof(Elf32_Sym, st_size), be);
+      entry.isFunction = (type == STT_FUNC);
+      entry.name = (const char *) &image[stroff + name];
+      elfSymbols.push_back(entry);
+    }
+  }
+
+  std::sort(elfSymbols.begin(), elfSymbols.end(), elfSymbolLess);
+}
+
+// Returns the symbol containing addr, or NULL when it falls outside all of them
+const ElfSymbol *findElfSymbol (unsigned int addr) {
+  loadElfSymbols();
+
+  ElfSymbol key;
+  key.addr = addr;
+  std::vector<ElfSymbol>::const_iterator it =
+    std::upper_bound(elfSymbols.begin(), elfSymbols.end(), key, elfSymbolLess);
+
+  if (it == elfSymbols.begin())
+    return NULL;
+  --it;
+
+  // zero-sized symbols (hand written assembly) cover up to the next one
+  if (it->size == 0 || addr < it->addr + it->size)
+    return &*it;
+  return NULL;
+}
+
+// Returns the first symbol called name, or NULL
+const ElfSymbol *findElfSymbolByName (const char *name) {
+  loadElfSymbols();
+  for (size_t i = 0; i < elfSymbols.size(); i++)
+    if (elfSymbols[i].name == name)
+      return &elfSymbols[i];
+  return NULL;
+}
+
+// Formats addr as "symbol+offset" into buf
+const char *symbolizeAddress (unsigned int addr, char *buf, size_t len) {
+  const ElfSymbol *sym = findElfSymbol(addr);
+  if (sym == NULL)
+    snprintf(buf, len, "%#x", addr);
+  else
+    snprintf(buf, len, "%s+%#x", sym->name.c_str(), addr - sym->addr);
+  return buf;
+}
+
+/*************************************************/
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef _MC723_ENERGY_H
+#define _MC723_ENERGY_H
+
+#include <math.h>
+#include <stdio.h>
+#include "mc723.h"
+
+/************** Energy / power model ****************/
+
+// Uncomment to estimate the energy, average power and energy-delay product
+// of the run from the model counters
+//#define ENERGY_MODEL
+
+/*
+ * Every event gets a fixed energy cost. SRAM arrays (cache tags and data,
+ * predictor tables) cost ENERGY_SRAM_BIT_PJ per bit read at the reference
+ * size, scaled by the square root of the array size in bits (bitline and
+ * wordline length), so changing the cache geometry changes the costs.
+ * Values are rough figures for a 45 nm embedded core.
+ */
+
+// Clock of the core, only used to turn cycles into time
+#define ENERGY_CLOCK_MHZ 200
+
+// SRAM read energy per bit of an array of ENERGY_SRAM_REF_BITS bits
+#define ENERGY_SRAM_BIT_PJ 0.05
+#define ENERGY_SRAM_REF_BITS 8192
+// writes drive both bitlines
+#define ENERGY_SRAM_WRITE_FACTOR 1.2
+
+// DRAM energy per byte transferred (line fill or writeback)
+#define ENERGY_DRAM_BYTE_PJ 160.0
+
+// Fetch, decode, register file and ALU of one instruction
+#define ENERGY_INSTRUCTION_PJ 12.0
+// Clock tree and pipeline latches of one stall cycle
+#define ENERGY_STALL_CYCLE_PJ 3.0
+// Static power of the core and caches
+#define ENERGY_LEAKAGE_MW 4.0
+
+// Cycles lost by each event in the in-order pipeline (CPI 1 otherwise)
+#define ENERGY_HAZARD_CYCLES 1
+#define ENERGY_MISPREDICT_CYCLES 2
+#define ENERGY_MISS_CYCLES 20
+
+#define ENERGY_WORD_BITS 32
+
+// Counters that are not already kept by the cache models
+typedef struct {
+  unsigned long long dataReads;
+  unsigned long long dataWrites;
+  unsigned long long dataWritebacks;
+} EnergyCounters;
+
+EnergyCounters energyCounters;
+
+void energyInit () {
+  EnergyCounters zero = { 0, 0, 0 };
+  energyCounters = zero;
+}
+
+// Energy of accessing bits of an array of rows x width bits
+double energyArray (unsigned int rows, unsigned int width, unsigned int bits, bool write) {
+  double scale = sqrt((double) rows * width / ENERGY_SRAM_REF_BITS);
+  double e = ENERGY_SRAM_BIT_PJ * bits * scale;
+  return write ? e * ENERGY_SRAM_WRITE_FACTOR : e;
+}
+
+// Tag array width: tag plus the valid and dirty bits
+unsigned int energyTagBits (unsigned int indexBits, unsigned int offsetBits) {
+  return 32 - indexBits - offsetBits + 2;
+}
+
+void energyLine (const char *name, double pj, double total) {
+  printf("  %-28s %14.3lf uJ (%5.2lf%%)\n", name, pj / 1e6, total > 0 ? 100.0 * pj / total : 0.0);
+}
+
+void energyReport (unsigned long long instructions, unsigned long long fetchProbes, unsigned long long hazards,
+                   unsigned long long dataMisses, unsigned long long instructionMisses) {
+  const EnergyCounters &c = energyCounters;
+
+  // data cache: every access reads the tag; loads read a word, stores
+  // write one; misses fill a whole line from DRAM, dirty lines go back
+  unsigned int dLineBits = 8 << DATA_BLOCK_OFFSET_SIZE_BITS;
+  unsigned int dTagBits = energyTagBits(DATA_CACHE_SIZE_BITS, DATA_BLOCK_OFFSET_SIZE_BITS);
+  unsigned long long dWritebacks = c.dataWritebacks;
+  unsigned long long dFills = dataMisses - dWritebacks;
+  double dTag = (c.dataReads + c.dataWrites) * energyArray(DATA_CACHE_SIZE, dTagBits, dTagBits, false)
+              + dFills * energyArray(DATA_CACHE_SIZE, dTagBits, dTagBits, true);
+  double dData = c.dataReads * energyArray(DATA_CACHE_SIZE, dLineBits, ENERGY_WORD_BITS, false)
+               + c.dataWrites * energyArray(DATA_CACHE_SIZE, dLineBits, ENERGY_WORD_BITS, true)
+               + dFills * energyArray(DATA_CACHE_SIZE, dLineBits, dLineBits, true)
+               + dWritebacks * energyArray(DATA_CACHE_SIZE, dLineBits, dLineBits, false);
+
+  // instruction cache: the tag and the whole line are read into the fetch
+  // buffer once per probe (mc723_frontend.h), not once per instruction
+  unsigned int iLineBits = 8 << INSTRUCTION_BLOCK_OFFSET_SIZE_BITS;
+  unsigned int iTagBits = energyTagBits(INSTRUCTION_CACHE_SIZE_BITS, INSTRUCTION_BLOCK_OFFSET_SIZE_BITS) - 1;
+  double iTag = fetchProbes * energyArray(INSTRUCTION_CACHE_SIZE, iTagBits, iTagBits, false)
+              + instructionMisses * energyArray(INSTRUCTION_CACHE_SIZE, iTagBits, iTagBits, true);
+  double iData = fetchProbes * energyArray(INSTRUCTION_CACHE_SIZE, iLineBits, iLineBits, false)
+               + instructionMisses * energyArray(INSTRUCTION_CACHE_SIZE, iLineBits, iLineBits, true);
+
+  double dram = (dFills + dWritebacks) * ENERGY_DRAM_BYTE_PJ * (1 << DATA_BLOCK_OFFSET_SIZE_BITS)
+              + instructionMisses * ENERGY_DRAM_BYTE_PJ * (1 << INSTRUCTION_BLOCK_OFFSET_SIZE_BITS);
+
+  // two-bits predictor: state and BTB target read at lookup, written back
+  unsigned long long branches = twoBitHitCount + twoBitMissCount;
+  unsigned int entryBits = 2 + 32;
+  double predictor = branches * (energyArray(1 << K, entryBits, entryBits, false)
+                                 + energyArray(1 << K, entryBits, entryBits, true));
+
+  unsigned long long stalls = hazards * ENERGY_HAZARD_CYCLES
+                            + twoBitMissCount * ENERGY_MISPREDICT_CYCLES
+                            + (dataMisses + instructionMisses) * ENERGY_MISS_CYCLES;
+  unsigned long long cycles = instructions + stalls;
+  double seconds = cycles / (ENERGY_CLOCK_MHZ * 1e6);
+
+  double core = instructions * ENERGY_INSTRUCTION_PJ;
+  double stall = stalls * ENERGY_STALL_CYCLE_PJ;
+  double leakage = ENERGY_LEAKAGE_MW * 1e9 * seconds;
+
+  double total = dTag + dData + iTag + iData + dram + predictor + core + stall + leakage;
+
+  printf("\n\n************************* ENERGY ********************************\n");
+  printf("- %llu cycles (%llu stall cycles) at %d MHz\n", cycles, stalls, ENERGY_CLOCK_MHZ);
+  energyLine("data cache tags", dTag, total);
+  energyLine("data cache data", dData, total);
+  energyLine("instruction cache tags", iTag, total);
+  energyLine("instruction cache data", iData, total);
+  energyLine("DRAM", dram, total);
+  energyLine("branch predictor", predictor, total);
+  energyLine("core (per instruction)", core, total);
+  energyLine("stall cycles", stall, total);
+  energyLine("leakage", leakage, total);
+  printf("total energy (uJ) = %lf\n", total / 1e6);
+  printf("execution time (ms) = %lf\n", seconds * 1e3);
+  printf("average power (mW) = %lf\n", seconds > 0 ? total / 1e9 / seconds : 0.0);
+  printf("energy-delay product (uJ ms) = %lf\n", total / 1e6 * seconds * 1e3);
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef _MC723_FRONTEND_H
+#define _MC723_FRONTEND_H
+
+#include <stdio.h>
+#include <string.h>
+#include "mc723.h"
+#include "mc723_timing.h"
+
+/************** Instruction fetch front-end ****************/
+
+// The fetch buffer is always on: it holds the instruction cache line being
+// fetched, so sequential fetches inside it do not probe instructionCache
+// again. Nothing else touches instructionCache between them, so the miss
+// counters are the same as probing on every fetch.
+
+// Uncomment to also model a loop buffer, instruction prefetching and the
+// fetch stall cycles
+//#define FRONTEND_MODEL
+
+// Instructions held by the loop buffer
+#define LOOP_BUFFER_SIZE 16
+
+// 1: on a demand miss (or the first use of a prefetched line) the next
+//    line is prefetched
+#define FRONTEND_NEXT_LINE_PREFETCH 1
+// 1: the line of the target predicted by the two-bits BTB is prefetched
+//    when the branch is fetched
+#define FRONTEND_TARGET_PREFETCH 1
+
+// Cycles to bring a line from memory
+#define FRONTEND_MISS_CYCLES 20
+
+#if defined(FRONTEND_MODEL) && defined(DECOUPLED_TIMING) && TIMING_THREADS > 1
+#error "FRONTEND_MODEL reads the branch predictors, so it needs a single timing thread"
+#endif
+
+#define FRONTEND_NO_LINE 0xFFFFFFFF
+
+typedef struct {
+  unsigned int bufferLine;        // line in the fetch buffer
+
+#ifdef FRONTEND_MODEL
+  unsigned int lastFetch;
+  unsigned int loopStart, loopEnd;
+  bool loopActive;
+
+  unsigned long long cycle;
+  unsigned long long readyCycle[INSTRUCTION_CACHE_SIZE];
+  bool prefetched[INSTRUCTION_CACHE_SIZE];
+#endif
+
+  unsigned long long fetches;
+  unsigned long long bufferFetches;
+  unsigned long long loopFetches;
+  unsigned long long probes;
+  unsigned long long demandMisses;
+  unsigned long long nextLinePrefetches;
+  unsigned long long targetPrefetches;
+  unsigned long long usefulPrefetches;
+  unsigned long long latePrefetches;
+  unsigned long long stallCycles;
+} FrontendModel;
+
+FrontendModel frontend[CORES];
+
+void frontendInit (FrontendModel &m) {
+  memset(&m, 0, sizeof(m));
+  m.bufferLine = FRONTEND_NO_LINE;
+}
+
+#ifdef FRONTEND_MODEL
+
+// Installs the line of addr in instructionCache unless it is there already
+bool frontendPrefetch (FrontendModel &m, unsigned int addr) {
+  unsigned int addr_aux = addr >> INSTRUCTION_BLOCK_OFFSET_SIZE_BITS;
+  int tag = addr_aux >> INSTRUCTION_CACHE_SIZE_BITS;
+  int row = addr_aux & INSTRUCTION_ROW_MASK;
+
+  if (instructionCache[row].valid && instructionCache[row].tag == tag)
+    return false;
+
+  instructionCache[row].tag = tag;
+  instructionCache[row].valid = true;
+  m.readyCycle[row] = m.cycle + FRONTEND_MISS_CYCLES;
+  m.prefetched[row] = true;
+  return true;
+}
+
+/*
+ * A fetch jumping back from the delay slot by less than the loop buffer
+ * size is a taken backward branch. The iteration after the first jump
+ * fills the buffer; from the second jump to the same loop on, fetches
+ * inside it are served by the buffer until one leaves the loop.
+ */
+bool frontendLoop (FrontendModel &m, unsigned int addr) {
+  if (m.loopActive) {
+    if (addr >= m.loopStart && addr <= m.loopEnd)
+      return true;
+    m.loopActive = false;
+    m.bufferLine = FRONTEND_NO_LINE;
+  }
+
+  if (addr < m.lastFetch && m.lastFetch - addr < LOOP_BUFFER_SIZE * 4) {
+    if (addr == m.loopStart && m.lastFetch == m.loopEnd) {
+      m.loopActive = true;
+      return true;
+    }
+    m.loopStart = addr;
+    m.loopEnd = m.lastFetch;
+  }
+  return false;
+}
+
+#endif
+
+// Returns true when the fetch of addr does not need to probe instructionCache
+inline bool frontendFetch (FrontendModel &m, unsigned int addr) {
+  m.fetches++;
+
+#ifdef FRONTEND_MODEL
+  m.cycle++;
+  bool loop = frontendLoop(m, addr);
+  m.lastFetch = addr;
+  if (loop) {
+    m.loopFetches++;
+    return true;
+  }
+
+  // the predictors are indexed by the delay slot address
+  if (FRONTEND_TARGET_PREFETCH) {
+    const TwoBitPredictor &btb = twoBitPredictor[PRED_INDEX((addr + 4))];
+    if ((btb.state == TAKEN_0 || btb.state == TAKEN_1) && frontendPrefetch(m, btb.jump_to))
+      m.targetPrefetches++;
+  }
+#endif
+
+  unsigned int line = addr >> INSTRUCTION_BLOCK_OFFSET_SIZE_BITS;
+  if (line == m.bufferLine) {
+    m.bufferFetches++;
+    return true;
+  }
+  m.bufferLine = line;
+  return false;
+}
+
+// Called after instructionCache was probed (and updated) for addr
+inline void frontendProbe (FrontendModel &m, unsigned int addr, int row, bool miss) {
+  m.probes++;
+
+#ifdef FRONTEND_MODEL
+  unsigned int nextLine = addr + (1 << INSTRUCTION_BLOCK_OFFSET_SIZE_BITS);
+
+  if (miss) {
+    m.demandMisses++;
+    m.stallCycles += FRONTEND_MISS_CYCLES;
+    m.cycle += FRONTEND_MISS_CYCLES;
+    m.prefetched[row] = false;
+    if (FRONTEND_NEXT_LINE_PREFETCH && frontendPrefetch(m, nextLine))
+      m.nextLinePrefetches++;
+
+  } else if (m.prefetched[row]) {
+    m.prefetched[row] = false;
+    m.usefulPrefetches++;
+
+    // still on its way from memory
+    if (m.readyCycle[row] > m.cycle) {
+      m.latePrefetches++;
+      m.stallCycles += m.readyCycle[row] - m.cycle;
+      m.cycle = m.readyCycle[row];
+    }
+    if (FRONTEND_NEXT_LINE_PREFETCH && frontendPrefetch(m, nextLine))
+      m.nextLinePrefetches++;
+  }
+#else
+  if (miss)
+    m.demandMisses++;
+#endif
+}
+
+unsigned long long frontendProbes () {
+  unsigned long long probes = 0;
+  for (int c = 0; c < CORES; c++)
+    probes += frontend[c].probes;
+  return probes;
+}
+
+void frontendReport () {
+  printf("\n\n************************* FRONT-END *****************************\n");
+  for (int c = 0; c < CORES; c++) {
+    const FrontendModel &m = frontend[c];
+    if (m.fetches == 0)
+      continue;
+    if (CORES > 1)
+      printf("core %d:\n", c);
+
+    double fetches = (double) m.fetches;
+    printf("- fetches: %llu, fetch buffer: %llu (%.2lf%%), loop buffer: %llu (%.2lf%%)\n", m.fetches,
+           m.bufferFetches, 100.0 * m.bufferFetches / fetches, m.loopFetches, 100.0 * m.loopFetches / fetches);
+    printf("- instruction cache probes: %llu (%.2lf%% of the fetches), demand misses: %llu\n",
+           m.probes, 100.0 * m.probes / fetches, m.demandMisses);
+#ifdef FRONTEND_MODEL
+    unsigned long long issued = m.nextLinePrefetches + m.targetPrefetches;
+    printf("- prefetches: %llu next-line + %llu target, useful: %llu (%.2lf%%), late: %llu\n",
+           m.nextLinePrefetches, m.targetPrefetches, m.usefulPrefetches,
+           issued ? 100.0 * m.usefulPrefetches / issued : 0.0, m.latePrefetches);
+    printf("- fetch stall cycles: %llu, fetch cycles per instruction: %.4lf\n", m.stallCycles,
+           (double) m.cycle / fetches);
+#endif
+  }
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
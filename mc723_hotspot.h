@@ -0,0 +1,117 @@
+#ifndef _MC723_HOTSPOT_H
+#define _MC723_HOTSPOT_H
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include "mc723.h"
+#include "mc723_elf.h"
+
+/************** Per-PC hotspot profiler ****************/
+
+// Uncomment to attribute every miss, misprediction and hazard to its PC
+//#define HOTSPOT_PROFILER
+
+// log2 of the number of slots in the PC table (must hold every distinct PC
+// that ever causes an event; further PCs are only counted as overflow)
+#define HOTSPOT_TABLE_BITS 16
+#define HOTSPOT_TABLE_SIZE (1 << HOTSPOT_TABLE_BITS)
+
+// How many PCs are listed for each event in the report
+#define HOTSPOT_TOP_N 15
+
+// Open addressing table keyed by PC. A slot is empty while used == false.
+typedef struct {
+  unsigned int pc;
+  bool used;
+  unsigned int count[PE_EVENTS];
+} HotspotEntry;
+
+HotspotEntry hotspotTable[HOTSPOT_TABLE_SIZE];
+unsigned int hotspotUsed;
+unsigned long long hotspotOverflow;
+
+#ifdef HOTSPOT_PROFILER
+#define HOTSPOT_RECORD(PC, EVENT, N) hotspotRecord((PC), (EVENT), (N))
+#else
+#define HOTSPOT_RECORD(PC, EVENT, N)
+#endif
+
+void hotspotInit () {
+  for (int i = 0; i < HOTSPOT_TABLE_SIZE; i++) {
+    hotspotTable[i].used = false;
+    for (int e = 0; e < PE_EVENTS; e++)
+      hotspotTable[i].count[e] = 0;
+  }
+  hotspotUsed = 0;
+  hotspotOverflow = 0;
+}
+
+// Fibonacci hashing of the word address, then linear probing
+void hotspotRecord (unsigned int pc, ProfileEvent event, unsigned int n) {
+  unsigned int slot = ((pc >> 2) * 2654435761u) >> (32 - HOTSPOT_TABLE_BITS);
+
+  for (int probe = 0; probe < HOTSPOT_TABLE_SIZE; probe++) {
+    HotspotEntry &entry = hotspotTable[slot];
+
+    if (entry.used && entry.pc == pc) {
+      entry.count[event] += n;
+      return;
+    }
+
+    if (!entry.used) {
+      // keep a quarter of the table free so probe sequences stay short
+      if (hotspotUsed >= HOTSPOT_TABLE_SIZE - HOTSPOT_TABLE_SIZE / 4)
+        break;
+      entry.used = true;
+      entry.pc = pc;
+      entry.count[event] = n;
+      hotspotUsed++;
+      return;
+    }
+
+    slot = (slot + 1) & (HOTSPOT_TABLE_SIZE - 1);
+  }
+
+  hotspotOverflow += n;
+}
+
+ProfileEvent hotspotSortEvent;
+
+bool hotspotMore (const HotspotEntry *a, const HotspotEntry *b) {
+  return a->count[hotspotSortEvent] > b->count[hotspotSortEvent];
+}
+
+void hotspotReport () {
+  std::vector<const HotspotEntry *> entries;
+  for (int i = 0; i < HOTSPOT_TABLE_SIZE; i++)
+    if (hotspotTable[i].used)
+      entries.push_back(&hotspotTable[i]);
+
+  printf("\n\n************************ HOTSPOTS *******************************\n");
+  printf("- distinct PCs: %u (overflowed events: %llu)\n", hotspotUsed, hotspotOverflow);
+
+  char name[256];
+  // instructions are not counted per PC, only the events that cost cycles
+  for (int e = PE_DATA_MISS; e < PE_EVENTS; e++) {
+    hotspotSortEvent = (ProfileEvent) e;
+    size_t top = std::min(entries.size(), (size_t) HOTSPOT_TOP_N);
+    std::partial_sort(entries.begin(), entries.begin() + top, entries.end(), hotspotMore);
+
+    unsigned long long total = 0;
+    for (size_t i = 0; i < entries.size(); i++)
+      total += entries[i]->count[e];
+
+    printf("\n- Top %s (total %llu):\n", profileEventName[e], total);
+    for (size_t i = 0; i < top && entries[i]->count[e] > 0; i++) {
+      printf("  %#010x %10u %6.2lf%%  %s\n", entries[i]->pc, entries[i]->count[e],
+             100.0 * entries[i]->count[e] / (double) total,
+             symbolizeAddress(entries[i]->pc, name, sizeof(name)));
+    }
+  }
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef _MC723_KSWEEP_H
+#define _MC723_KSWEEP_H
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "mc723.h"
+
+/************** Predictor size sweep ****************/
+
+// Uncomment to run the one-bit and two-bits predictors with every table
+// size from 2^KSWEEP_MIN to 2^KSWEEP_MAX entries on the same branches, next
+// to the K-sized ones of the model
+//#define PREDICTOR_SWEEP
+
+#define KSWEEP_MIN 4
+#define KSWEEP_MAX 20
+
+// One "[K = n]" line per size, in the format of ../bench.txt
+#define KSWEEP_FILE "../bench_sweep.txt"
+
+#if defined(PREDICTOR_SWEEP) && defined(DECOUPLED_TIMING) && TIMING_THREADS > 1
+#error "PREDICTOR_SWEEP keeps one set of tables per core, so it needs a single timing thread"
+#endif
+
+/*
+ * Every size is a lane. The tables of all sizes are concatenated in
+ * structure-of-arrays form (states and BTB targets apart); each branch
+ * gathers one entry per lane, runs the predictor state machines of
+ * branchTaken/branchNotTaken branch-free on KSWEEP_WIDTH lanes at a time
+ * with the GCC vector extensions, and scatters the entries back. The
+ * gather and scatter are plain loops that the compiler may vectorize (with
+ * AVX2, for instance); the state machines and the miss counters are SIMD on
+ * any target.
+ */
+
+typedef unsigned int KSweepVec __attribute__ ((vector_size (16)));
+#define KSWEEP_WIDTH 4
+
+#define KSWEEP_SIZES (KSWEEP_MAX - KSWEEP_MIN + 1)
+#define KSWEEP_LANES ((KSWEEP_SIZES + KSWEEP_WIDTH - 1) / KSWEEP_WIDTH * KSWEEP_WIDTH)
+#define KSWEEP_VECS (KSWEEP_LANES / KSWEEP_WIDTH)
+
+// The vector miss counters are added to the 64 bit totals this often
+#define KSWEEP_FLUSH (1u << 30)
+
+typedef struct {
+  // entry of lane l for an address: offset[l] + ((addr >> 2) & mask[l])
+  unsigned int offset[KSWEEP_LANES] __attribute__ ((aligned (16)));
+  unsigned int mask[KSWEEP_LANES] __attribute__ ((aligned (16)));
+
+  std::vector<unsigned char> oneState;
+  std::vector<unsigned int> oneTarget;
+  std::vector<unsigned char> twoState;
+  std::vector<unsigned int> twoTarget;
+
+  KSweepVec oneMisses[KSWEEP_VECS];
+  KSweepVec twoMisses[KSWEEP_VECS];
+  unsigned int pending;
+
+  unsigned long long oneMissTotal[KSWEEP_LANES];
+  unsigned long long twoMissTotal[KSWEEP_LANES];
+  unsigned long long branches;
+  unsigned long long taken;
+} KSweepModel;
+
+KSweepModel kSweep[CORES];
+
+void kSweepInit (KSweepModel &m) {
+  // 2^KSWEEP_MIN + ... + 2^(k-1) = 2^k - 2^KSWEEP_MIN entries come before size k;
+  // the padding lanes get one private entry each after the last table
+  unsigned int total = (1u << (KSWEEP_MAX + 1)) - (1u << KSWEEP_MIN);
+  for (int l = 0; l < KSWEEP_LANES; l++) {
+    if (l < KSWEEP_SIZES) {
+      m.offset[l] = (1u << (KSWEEP_MIN + l)) - (1u << KSWEEP_MIN);
+      m.mask[l] = (1u << (KSWEEP_MIN + l)) - 1;
+    } else {
+      m.offset[l] = total + l - KSWEEP_SIZES;
+      m.mask[l] = 0;
+    }
+  }
+  total += KSWEEP_LANES - KSWEEP_SIZES;
+
+  // the global predictor arrays start zeroed: NOT_TAKEN / NOT_TAKEN_1
+  m.oneState.assign(total, NOT_TAKEN);
+  m.oneTarget.assign(total, 0);
+  m.twoState.assign(total, NOT_TAKEN_1);
+  m.twoTarget.assign(total, 0);
+
+  memset(m.oneMisses, 0, sizeof(m.oneMisses));
+  memset(m.twoMisses, 0, sizeof(m.twoMisses));
+  m.pending = 0;
+  memset(m.oneMissTotal, 0, sizeof(m.oneMissTotal));
+  memset(m.twoMissTotal, 0, sizeof(m.twoMissTotal));
+  m.branches = m.taken = 0;
+}
+
+void kSweepFlush (KSweepModel &m) {
+  for (int v = 0; v < KSWEEP_VECS; v++)
+    for (int i = 0; i < KSWEEP_WIDTH; i++) {
+      m.oneMissTotal[v * KSWEEP_WIDTH + i] += m.oneMisses[v][i];
+      m.twoMissTotal[v * KSWEEP_WIDTH + i] += m.twoMisses[v][i];
+    }
+  memset(m.oneMisses, 0, sizeof(m.oneMisses));
+  memset(m.twoMisses, 0, sizeof(m.twoMisses));
+  m.pending = 0;
+}
+
+// Lanes where c is all ones take a, the others b
+inline KSweepVec kSweepSelect (KSweepVec c, KSweepVec a, KSweepVec b) {
+  return (a & c) | (b & ~c);
+}
+
+/*
+ * Same arguments as branchTaken/branchNotTaken: ac_pc is the delay slot
+ * address the predictors are indexed by.
+ */
+void kSweepBranch (KSweepModel &m, unsigned int ac_pc, unsigned int jmp_addr, bool taken) {
+  unsigned int index[KSWEEP_LANES] __attribute__ ((aligned (16)));
+  unsigned int oneS[KSWEEP_LANES] __attribute__ ((aligned (16)));
+  unsigned int oneT[KSWEEP_LANES] __attribute__ ((aligned (16)));
+  unsigned int twoS[KSWEEP_LANES] __attribute__ ((aligned (16)));
+  unsigned int twoT[KSWEEP_LANES] __attribute__ ((aligned (16)));
+
+  unsigned int word = ac_pc >> 2;
+  for (int l = 0; l < KSWEEP_LANES; l++) {
+    index[l] = m.offset[l] + (word & m.mask[l]);
+    oneS[l] = m.oneState[index[l]];
+    oneT[l] = m.oneTarget[index[l]];
+    twoS[l] = m.twoState[index[l]];
+    twoT[l] = m.twoTarget[index[l]];
+  }
+
+  KSweepVec jmp = { jmp_addr, jmp_addr, jmp_addr, jmp_addr };
+  KSweepVec next = { ac_pc + 4, ac_pc + 4, ac_pc + 4, ac_pc + 4 };
+  KSweepVec zero = { 0, 0, 0, 0 };
+  KSweepVec one = { 1, 1, 1, 1 };
+  KSweepVec two = one + one, three = two + one;
+
+  for (int v = 0; v < KSWEEP_VECS; v++) {
+    KSweepVec *os = (KSweepVec *) &oneS[v * KSWEEP_WIDTH];
+    KSweepVec *ot = (KSweepVec *) &oneT[v * KSWEEP_WIDTH];
+    KSweepVec *ts = (KSweepVec *) &twoS[v * KSWEEP_WIDTH];
+    KSweepVec *tt = (KSweepVec *) &twoT[v * KSWEEP_WIDTH];
+    KSweepVec oneMiss, twoMiss;
+
+    if (taken) {
+      // one-bit: wrong direction or wrong target
+      oneMiss = (KSweepVec) (*os == zero) | (KSweepVec) (*ot != jmp);
+      *os = one;
+      *ot = jmp;
+
+      // two-bits: not-taken states count up, a wrong target counts down,
+      // a hit saturates; the target is (re)written unless still not taken
+      KSweepVec notTaken = (KSweepVec) (*ts < two);
+      KSweepVec wrongTarget = ~notTaken & (KSweepVec) (*tt != jmp);
+      twoMiss = notTaken | wrongTarget;
+      KSweepVec state = kSweepSelect(notTaken, *ts + one, kSweepSelect(wrongTarget, *ts - one, three));
+      *tt = kSweepSelect(notTaken & (KSweepVec) (state != two), *tt, jmp);
+      *ts = state;
+    } else {
+      oneMiss = (KSweepVec) (*os == one);
+      *ot = kSweepSelect(oneMiss, next, *ot);
+      *os = zero;
+
+      KSweepVec wasTaken = (KSweepVec) (*ts >= two);
+      twoMiss = wasTaken;
+      KSweepVec state = kSweepSelect(wasTaken, kSweepSelect((KSweepVec) (*ts == two), one, two), zero);
+      *tt = kSweepSelect((KSweepVec) (state == two), jmp, next);
+      *ts = state;
+    }
+
+    m.oneMisses[v] -= oneMiss;   // all ones is -1
+    m.twoMisses[v] -= twoMiss;
+  }
+
+  for (int l = 0; l < KSWEEP_LANES; l++) {
+    m.oneState[index[l]] = oneS[l];
+    m.oneTarget[index[l]] = oneT[l];
+    m.twoState[index[l]] = twoS[l];
+    m.twoTarget[index[l]] = twoT[l];
+  }
+
+  m.branches++;
+  m.taken += taken;
+  if (++m.pending == KSWEEP_FLUSH)
+    kSweepFlush(m);
+}
+
+void kSweepReport () {
+  printf("\n\n********************* PREDICTOR SIZE SWEEP **********************\n");
+  FILE *fp = fopen(KSWEEP_FILE, "a");
+  for (int c = 0; c < CORES; c++) {
+    KSweepModel &m = kSweep[c];
+    if (m.branches == 0)
+      continue;
+    kSweepFlush(m);
+    if (CORES > 1)
+      printf("core %d:\n", c);
+
+    printf("  %4s %10s %14s %9s %14s %9s\n", "K", "entries", "one-bit miss", "rate", "two-bits miss", "rate");
+    for (int l = 0; l < KSWEEP_SIZES; l++) {
+      printf("  %4d %10u %14llu %8.3lf%% %14llu %8.3lf%%\n", KSWEEP_MIN + l, 1u << (KSWEEP_MIN + l),
+             m.oneMissTotal[l], 100.0 * m.oneMissTotal[l] / m.branches,
+             m.twoMissTotal[l], 100.0 * m.twoMissTotal[l] / m.branches);
+      if (fp != NULL)
+        fprintf(fp, "[K = %d] %llu\t\t%llu\t\t%llu\t\t%llu\n", KSWEEP_MIN + l, m.branches - m.taken, m.taken,
+                m.oneMissTotal[l], m.twoMissTotal[l]);
+    }
+  }
+  if (fp != NULL)
+    fclose(fp);
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
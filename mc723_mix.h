@@ -0,0 +1,278 @@
+#ifndef _MC723_MIX_H
+#define _MC723_MIX_H
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include "mc723.h"
+#include "mc723_elf.h"
+
+/************** Instruction mix / dependency analytics ****************/
+
+// Uncomment to record the dynamic instruction mix, load-to-use and
+// HI/LO distances and per-branch taken rates
+//#define INSTRUCTION_MIX
+
+// Distances >= this are counted together in the last bucket
+#define MIX_MAX_DISTANCE 16
+
+// log2 of the number of static branch slots (indexed by PC bits, so
+// branches further apart than 4 << MIX_BRANCH_BITS may alias)
+#define MIX_BRANCH_BITS 16
+#define MIX_BRANCH_SIZE (1 << MIX_BRANCH_BITS)
+
+// How many static branches are listed in the report
+#define MIX_TOP_N 15
+
+// Slots of the mix histogram: opcode, then SPECIAL function, then REGIMM rt
+#define MIX_OPCODE 0
+#define MIX_FUNCT 64
+#define MIX_REGIMM 128
+#define MIX_NOP 160
+#define MIX_SLOTS 161
+
+// Registers are indexed with (r & MIX_REG_MASK), so NOT_USED lands on a
+// dummy slot instead of needing a test
+#define MIX_REG_MASK 63
+
+// Every histogram has one extra slot that swallows the updates of
+// instructions that must not be counted, to keep the hot path branch free
+#define MIX_SINK (MIX_MAX_DISTANCE + 1)
+
+#if CORES > 1 && defined(INSTRUCTION_MIX)
+#error "INSTRUCTION_MIX keeps a single register history and cannot follow more than one core"
+#endif
+
+unsigned long long mixCount[MIX_SLOTS];
+const char *mixName[MIX_SLOTS];
+
+unsigned int mixNow;
+unsigned int mixLoadTime[MIX_REG_MASK + 1];
+unsigned int mixLoadPending[MIX_REG_MASK + 1];
+unsigned long long mixLoadUse[MIX_SINK + 1];
+
+unsigned int mixHiLoTime;
+unsigned int mixHiLoPending;
+unsigned long long mixHiLoUse[MIX_SINK + 1];
+unsigned char mixIsMulDiv[64];
+unsigned char mixIsMoveFromHiLo[64];
+
+typedef struct {
+  unsigned int pc;
+  unsigned int executed;
+  unsigned int taken;
+} MixBranch;
+
+MixBranch mixBranch[MIX_BRANCH_SIZE];
+
+#ifdef INSTRUCTION_MIX
+#define MIX_RECORD(SLOT) (mixCount[SLOT]++)
+#else
+#define MIX_RECORD(SLOT)
+#endif
+
+void mixSetName (int slot, const char *name) {
+  mixName[slot] = name;
+}
+
+void mixInit () {
+  for (int i = 0; i < MIX_SLOTS; i++) {
+    mixCount[i] = 0;
+    mixName[i] = NULL;
+  }
+
+  mixSetName(MIX_OPCODE + 0x02, "j");      mixSetName(MIX_OPCODE + 0x03, "jal");
+  mixSetName(MIX_OPCODE + 0x04, "beq");    mixSetName(MIX_OPCODE + 0x05, "bne");
+  mixSetName(MIX_OPCODE + 0x06, "blez");   mixSetName(MIX_OPCODE + 0x07, "bgtz");
+  mixSetName(MIX_OPCODE + 0x08, "addi");   mixSetName(MIX_OPCODE + 0x09, "addiu");
+  mixSetName(MIX_OPCODE + 0x0A, "slti");   mixSetName(MIX_OPCODE + 0x0B, "sltiu");
+  mixSetName(MIX_OPCODE + 0x0C, "andi");   mixSetName(MIX_OPCODE + 0x0D, "ori");
+  mixSetName(MIX_OPCODE + 0x0E, "xori");   mixSetName(MIX_OPCODE + 0x0F, "lui");
+  mixSetName(MIX_OPCODE + 0x20, "lb");     mixSetName(MIX_OPCODE + 0x21, "lh");
+  mixSetName(MIX_OPCODE + 0x22, "lwl");    mixSetName(MIX_OPCODE + 0x23, "lw");
+  mixSetName(MIX_OPCODE + 0x24, "lbu");    mixSetName(MIX_OPCODE + 0x25, "lhu");
+  mixSetName(MIX_OPCODE + 0x26, "lwr");    mixSetName(MIX_OPCODE + 0x28, "sb");
+  mixSetName(MIX_OPCODE + 0x29, "sh");     mixSetName(MIX_OPCODE + 0x2A, "swl");
+  mixSetName(MIX_OPCODE + 0x2B, "sw");     mixSetName(MIX_OPCODE + 0x2E, "swr");
+
+  mixSetName(MIX_FUNCT + 0x00, "sll");     mixSetName(MIX_FUNCT + 0x02, "srl");
+  mixSetName(MIX_FUNCT + 0x03, "sra");     mixSetName(MIX_FUNCT + 0x04, "sllv");
+  mixSetName(MIX_FUNCT + 0x06, "srlv");    mixSetName(MIX_FUNCT + 0x07, "srav");
+  mixSetName(MIX_FUNCT + 0x08, "jr");      mixSetName(MIX_FUNCT + 0x09, "jalr");
+  mixSetName(MIX_FUNCT + 0x0C, "syscall"); mixSetName(MIX_FUNCT + 0x0D, "break");
+  mixSetName(MIX_FUNCT + 0x10, "mfhi");    mixSetName(MIX_FUNCT + 0x11, "mthi");
+  mixSetName(MIX_FUNCT + 0x12, "mflo");    mixSetName(MIX_FUNCT + 0x13, "mtlo");
+  mixSetName(MIX_FUNCT + 0x18, "mult");    mixSetName(MIX_FUNCT + 0x19, "multu");
+  mixSetName(MIX_FUNCT + 0x1A, "div");     mixSetName(MIX_FUNCT + 0x1B, "divu");
+  mixSetName(MIX_FUNCT + 0x20, "add");     mixSetName(MIX_FUNCT + 0x21, "addu");
+  mixSetName(MIX_FUNCT + 0x22, "sub");     mixSetName(MIX_FUNCT + 0x23, "subu");
+  mixSetName(MIX_FUNCT + 0x24, "and");     mixSetName(MIX_FUNCT + 0x25, "or");
+  mixSetName(MIX_FUNCT + 0x26, "xor");     mixSetName(MIX_FUNCT + 0x27, "nor");
+  mixSetName(MIX_FUNCT + 0x2A, "slt");     mixSetName(MIX_FUNCT + 0x2B, "sltu");
+
+  mixSetName(MIX_REGIMM + 0x00, "bltz");   mixSetName(MIX_REGIMM + 0x01, "bgez");
+  mixSetName(MIX_REGIMM + 0x10, "bltzal"); mixSetName(MIX_REGIMM + 0x11, "bgezal");
+  mixSetName(MIX_NOP, "nop");
+
+  mixNow = 0;
+  for (int r = 0; r <= MIX_REG_MASK; r++) {
+    mixLoadTime[r] = 0;
+    mixLoadPending[r] = 0;
+  }
+  for (int d = 0; d <= MIX_SINK; d++) {
+    mixLoadUse[d] = 0;
+    mixHiLoUse[d] = 0;
+  }
+
+  mixHiLoTime = 0;
+  mixHiLoPending = 0;
+  for (int f = 0; f < 64; f++) {
+    mixIsMulDiv[f] = (f >= 0x18 && f <= 0x1B);
+    mixIsMoveFromHiLo[f] = (f == 0x10 || f == 0x12);
+  }
+
+  for (int i = 0; i < MIX_BRANCH_SIZE; i++) {
+    mixBranch[i].pc = 0;
+    mixBranch[i].executed = 0;
+    mixBranch[i].taken = 0;
+  }
+}
+
+// Histogram slot for a distance, or the sink when pending is 0
+inline unsigned int mixDistanceSlot (unsigned int distance, unsigned int pending) {
+  unsigned int d = distance < MIX_MAX_DISTANCE ? distance : MIX_MAX_DISTANCE;
+  return pending ? d : MIX_SINK;
+}
+
+/*
+ * Called from createContext for every instruction. Only the first read of
+ * a loaded value counts as its use; the reads are handled before the write
+ * so that "lw r1, 0(r1)" sees the previous producer of r1.
+ */
+inline void mixDependencies (int r_dest, int r_read1, int r_read2, InstructionType type) {
+  unsigned int now = ++mixNow;
+  unsigned int r1 = r_read1 & MIX_REG_MASK;
+  unsigned int r2 = r_read2 & MIX_REG_MASK;
+  unsigned int w = r_dest & MIX_REG_MASK;
+
+  mixLoadUse[mixDistanceSlot(now - mixLoadTime[r1], mixLoadPending[r1])]++;
+  mixLoadPending[r1] = 0;
+  mixLoadUse[mixDistanceSlot(now - mixLoadTime[r2], mixLoadPending[r2])]++;
+  mixLoadPending[r2] = 0;
+
+  mixLoadTime[w] = now;
+  mixLoadPending[w] = (type == MEMORY_READ);
+}
+
+// Distance between a mult/div and the mfhi/mflo that reads its result
+inline void mixHiLo (unsigned int func) {
+  unsigned int isMulDiv = mixIsMulDiv[func];
+  unsigned int isMoveFrom = mixIsMoveFromHiLo[func];
+
+  mixHiLoUse[mixDistanceSlot(mixNow - mixHiLoTime, mixHiLoPending & isMoveFrom)]++;
+  mixHiLoPending = (mixHiLoPending & !isMoveFrom) | isMulDiv;
+  mixHiLoTime = isMulDiv ? mixNow : mixHiLoTime;
+}
+
+inline void mixBranchOutcome (unsigned int pc, unsigned int taken) {
+  MixBranch &b = mixBranch[(pc >> 2) & (MIX_BRANCH_SIZE - 1)];
+  b.pc = pc;
+  b.executed++;
+  b.taken += taken;
+}
+
+/*-------------------------- Report --------------------------*/
+
+bool mixSlotMore (int a, int b) {
+  return mixCount[a] > mixCount[b];
+}
+
+bool mixBranchMore (const MixBranch *a, const MixBranch *b) {
+  return a->executed > b->executed;
+}
+
+void mixPrintDistances (const char *title, const unsigned long long *histogram) {
+  unsigned long long total = 0;
+  for (int d = 0; d <= MIX_MAX_DISTANCE; d++)
+    total += histogram[d];
+
+  printf("\n- %s (%llu):\n", title, total);
+  for (int d = 1; d <= MIX_MAX_DISTANCE; d++) {
+    if (histogram[d] == 0)
+      continue;
+    printf("  %s%2d %14llu %8.4lf%%\n", d == MIX_MAX_DISTANCE ? ">=" : "  ", d,
+           histogram[d], 100.0 * histogram[d] / (double) total);
+  }
+}
+
+void mixReport () {
+  unsigned long long total = 0;
+  std::vector<int> slots;
+  for (int i = 0; i < MIX_SLOTS; i++) {
+    total += mixCount[i];
+    if (mixCount[i] != 0)
+      slots.push_back(i);
+  }
+  std::sort(slots.begin(), slots.end(), mixSlotMore);
+
+  printf("\n\n********************** INSTRUCTION MIX **************************\n");
+  printf("- instructions: %llu\n", total);
+  for (size_t i = 0; i < slots.size(); i++) {
+    char unknown[16];
+    const char *name = mixName[slots[i]];
+    if (name == NULL) {
+      snprintf(unknown, sizeof(unknown), "slot_%d", slots[i]);
+      name = unknown;
+    }
+    printf("  %-8s %14llu %8.4lf%%\n", name, mixCount[slots[i]],
+           100.0 * mixCount[slots[i]] / (double) total);
+  }
+
+  unsigned long long mulDiv = 0;
+  for (int f = 0x18; f <= 0x1B; f++)
+    mulDiv += mixCount[MIX_FUNCT + f];
+  printf("\n- mult/div: %llu (%.4lf%%), one every %.1lf instructions\n", mulDiv,
+         100.0 * mulDiv / (double) total, mulDiv ? (double) total / mulDiv : 0.0);
+
+  mixPrintDistances("Load-to-use distance (instructions)", mixLoadUse);
+  mixPrintDistances("mult/div to mfhi/mflo distance (instructions)", mixHiLoUse);
+
+  std::vector<const MixBranch *> branches;
+  unsigned long long executed = 0;
+  unsigned long long rateBins[11] = { 0 };
+  for (int i = 0; i < MIX_BRANCH_SIZE; i++) {
+    if (mixBranch[i].executed == 0)
+      continue;
+    branches.push_back(&mixBranch[i]);
+    executed += mixBranch[i].executed;
+    rateBins[10 * (unsigned long long) mixBranch[i].taken / mixBranch[i].executed] += mixBranch[i].executed;
+  }
+
+  printf("\n- Static branches: %u, dynamic: %llu\n", (unsigned int) branches.size(), executed);
+  printf("  dynamic branches by taken rate:\n");
+  for (int b = 0; b <= 10; b++) {
+    if (rateBins[b] == 0)
+      continue;
+    char range[16];
+    if (b == 10)
+      snprintf(range, sizeof(range), "100%%");
+    else
+      snprintf(range, sizeof(range), "[%d%%, %d%%)", b * 10, b * 10 + 10);
+    printf("  %-12s %14llu %8.4lf%%\n", range, rateBins[b], 100.0 * rateBins[b] / (double) executed);
+  }
+
+  size_t top = std::min(branches.size(), (size_t) MIX_TOP_N);
+  std::partial_sort(branches.begin(), branches.begin() + top, branches.end(), mixBranchMore);
+  char name[256];
+  printf("  most executed:\n");
+  for (size_t i = 0; i < top; i++) {
+    printf("  %#010x %12u %7.2lf%% taken  %s\n", branches[i]->pc, branches[i]->executed,
+           100.0 * branches[i]->taken / (double) branches[i]->executed,
+           symbolizeAddress(branches[i]->pc, name, sizeof(name)));
+  }
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef _MC723_MSHR_H
+#define _MC723_MSHR_H
+
+#include <stdio.h>
+#include <string.h>
+#include "mc723.h"
+#include "mc723_coherence.h"
+
+/************** Non-blocking data cache (MSHRs) ****************/
+
+// Uncomment to make dataCache lockup-free: misses take MSHR_MISS_CYCLES in
+// an MSHR while the pipeline keeps going until an instruction uses a
+// register loaded by a pending miss
+//#define MSHR_MODEL
+
+// Miss status holding registers, and the accesses each one can merge
+#define MSHR_COUNT 4
+#define MSHR_TARGETS 4
+
+#define MSHR_MISS_CYCLES 20
+
+#if MSHR_COUNT > 64
+#error "MSHR_COUNT must be at most 64"
+#endif
+#if defined(MSHR_MODEL) && defined(DECOUPLED_TIMING) && TIMING_THREADS > 1
+#error "MSHR_MODEL keeps the pipeline clock of each core, so it needs a single timing thread"
+#endif
+
+/*
+ * Every instruction takes one cycle plus its stalls. A dataCache miss
+ * (dataCacheMiss went up) takes a free MSHR, or stalls until the oldest
+ * fill when all are busy; an access to a line with a pending MSHR merges
+ * into it as a secondary miss, stalling only when its targets are full.
+ * A load makes its destination ready at the fill, and createContext
+ * stalls an instruction reading it before then (stall-on-use). Stores
+ * retire into the MSHR without stalling. Hits pay nothing here: the one
+ * cycle load-use stall is already in hazardCount.
+ */
+
+typedef struct {
+  unsigned int line;
+  unsigned long long fill;      // cycle the line arrives
+  int targets;
+} Mshr;
+
+typedef struct {
+  Mshr entry[MSHR_COUNT];
+  unsigned long long busy;      // bit per entry
+  unsigned long long cycle;
+  unsigned long long regReady[32];
+  int dest;                     // destination of the current instruction
+
+  unsigned long long occupancy[MSHR_COUNT + 1];   // cycles with n entries busy
+  unsigned long long instructions;
+  unsigned long long primaryMisses, secondaryMisses;
+  unsigned long long hitsUnderMiss;
+  unsigned long long fullStalls, targetStalls, useStalls;
+} MshrModel;
+
+MshrModel mshr[CORES];
+
+void mshrInit (MshrModel &m) {
+  memset(&m, 0, sizeof(m));
+  m.dest = NOT_USED;
+}
+
+inline int mshrBusy (const MshrModel &m) {
+  return __builtin_popcountll(m.busy);
+}
+
+// Moves the clock to cycle, freeing the entries filled on the way
+void mshrAdvance (MshrModel &m, unsigned long long cycle) {
+  while (m.cycle < cycle) {
+    unsigned long long next = cycle;
+    for (unsigned long long b = m.busy; b; b &= b - 1) {
+      int e = __builtin_ctzll(b);
+      if (m.entry[e].fill < next)
+        next = m.entry[e].fill;
+    }
+    if (next <= m.cycle)
+      next = m.cycle;
+    m.occupancy[mshrBusy(m)] += next - m.cycle;
+    m.cycle = next;
+
+    for (unsigned long long b = m.busy; b; b &= b - 1) {
+      int e = __builtin_ctzll(b);
+      if (m.entry[e].fill <= m.cycle)
+        m.busy &= ~(1ull << e);
+    }
+  }
+}
+
+// Stalls until cycle, charging the wait to counter
+inline void mshrStall (MshrModel &m, unsigned long long cycle, unsigned long long &counter) {
+  if (cycle > m.cycle) {
+    counter += cycle - m.cycle;
+    mshrAdvance(m, cycle);
+  }
+}
+
+// Called once per instruction, before its fetch
+inline void mshrInstruction (MshrModel &m) {
+  m.instructions++;
+  mshrAdvance(m, m.cycle + 1);
+  m.dest = NOT_USED;
+}
+
+// Called from createContext: stall-on-use of the source registers
+inline void mshrContext (MshrModel &m, int r_dest, int r_read1, int r_read2) {
+  if (r_read1 > 0)
+    mshrStall(m, m.regReady[r_read1], m.useStalls);
+  if (r_read2 > 0)
+    mshrStall(m, m.regReady[r_read2], m.useStalls);
+  if (r_dest > 0)
+    m.regReady[r_dest] = m.cycle;
+  m.dest = r_dest;
+}
+
+// One dataCache access; miss tells whether dataCache missed on it
+void mshrAccess (MshrModel &m, unsigned int addr, bool miss, bool write) {
+  unsigned int line = addr >> DATA_BLOCK_OFFSET_SIZE_BITS;
+  unsigned long long ready = m.cycle;
+
+  int found = -1;
+  for (unsigned long long b = m.busy; b; b &= b - 1) {
+    int e = __builtin_ctzll(b);
+    if (m.entry[e].line == line)
+      found = e;
+  }
+
+  if (found >= 0) {
+    // the line is on its way: merge, or wait for it if no target is left
+    Mshr &e = m.entry[found];
+    m.secondaryMisses++;
+    if (e.targets == MSHR_TARGETS) {
+      mshrStall(m, e.fill, m.targetStalls);
+    } else {
+      e.targets++;
+      ready = e.fill;
+    }
+  } else if (miss) {
+    if (m.busy == (MSHR_COUNT == 64 ? ~0ull : (1ull << MSHR_COUNT) - 1)) {
+      unsigned long long oldest = ~0ull;
+      for (int e = 0; e < MSHR_COUNT; e++)
+        if (m.entry[e].fill < oldest)
+          oldest = m.entry[e].fill;
+      mshrStall(m, oldest, m.fullStalls);
+    }
+    int e = __builtin_ctzll(~m.busy);
+    m.busy |= 1ull << e;
+    m.entry[e].line = line;
+    m.entry[e].fill = m.cycle + MSHR_MISS_CYCLES;
+    m.entry[e].targets = 1;
+    m.primaryMisses++;
+    ready = m.entry[e].fill;
+  } else if (m.busy) {
+    m.hitsUnderMiss++;
+  }
+
+  if (!write && m.dest > 0 && ready > m.regReady[m.dest])
+    m.regReady[m.dest] = ready;
+}
+
+void mshrReport (unsigned long long hazards) {
+  printf("\n\n******************** NON-BLOCKING DATA CACHE ********************\n");
+  printf("- %d MSHRs, %d targets each, %d cycle misses\n", MSHR_COUNT, MSHR_TARGETS, MSHR_MISS_CYCLES);
+  for (int c = 0; c < CORES; c++) {
+    MshrModel &m = mshr[c];
+    if (m.instructions == 0)
+      continue;
+    if (CORES > 1)
+      printf("core %d:\n", c);
+
+    // drain the outstanding fills
+    unsigned long long last = m.cycle;
+    for (unsigned long long b = m.busy; b; b &= b - 1)
+      if (m.entry[__builtin_ctzll(b)].fill > last)
+        last = m.entry[__builtin_ctzll(b)].fill;
+    mshrAdvance(m, last);
+
+    // hazardCount is the total of every core
+    unsigned long long extra = CORES == 1 ? hazards : cores[c].stats.counters.hazards;
+    unsigned long long cycles = m.cycle + extra;
+    unsigned long long blocking = m.instructions + extra + m.primaryMisses * MSHR_MISS_CYCLES;
+    printf("  primary misses %llu, secondary (merged) %llu, hits under miss %llu\n",
+           m.primaryMisses, m.secondaryMisses, m.hitsUnderMiss);
+    printf("  stall cycles: use %llu, MSHRs full %llu, targets full %llu\n",
+           m.useStalls, m.fullStalls, m.targetStalls);
+    printf("  cycles %llu (CPI %.3lf), blocking cache %llu (CPI %.3lf)\n", cycles,
+           (double) cycles / m.instructions, blocking, (double) blocking / m.instructions);
+
+    unsigned long long missCycles = 0, weighted = 0;
+    for (int n = 1; n <= MSHR_COUNT; n++) {
+      missCycles += m.occupancy[n];
+      weighted += n * m.occupancy[n];
+    }
+    printf("  average MLP %.3lf over %llu cycles with a miss outstanding\n",
+           missCycles ? (double) weighted / missCycles : 0.0, missCycles);
+    printf("  MSHR occupancy:");
+    for (int n = 0; n <= MSHR_COUNT; n++)
+      printf(" %d: %.2lf%%", n, m.cycle ? 100.0 * m.occupancy[n] / m.cycle : 0.0);
+    printf("\n");
+  }
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
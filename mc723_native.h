@@ -0,0 +1,319 @@
+#ifndef _MC723_NATIVE_H
+#define _MC723_NATIVE_H
+
+#include <stdio.h>
+#include <string.h>
+#include "mc723.h"
+#include "mc723_elf.h"
+
+/************** Native libc routines ****************/
+
+// Uncomment to run memcpy, memset, strlen and memcmp of the guest libc on
+// the host: a call is turned into a jump to its return address and the
+// routine is done in bulk on the guest memory, with its dataCache events
+// and a calibrated instruction count
+//#define NATIVE_LIBC
+
+// Uncomment (without NATIVE_LIBC) to measure the guest routines instead and
+// print the NATIVE_*_BASE / NATIVE_*_PER_BYTE values that fit them
+//#define NATIVE_CALIBRATE
+
+// Guest instructions charged per call: BASE + PER_BYTE * bytes processed
+#define NATIVE_MEMCPY_BASE 20.0
+#define NATIVE_MEMCPY_PER_BYTE 0.75
+#define NATIVE_MEMSET_BASE 16.0
+#define NATIVE_MEMSET_PER_BYTE 0.5
+#define NATIVE_STRLEN_BASE 8.0
+#define NATIVE_STRLEN_PER_BYTE 4.0
+#define NATIVE_MEMCMP_BASE 10.0
+#define NATIVE_MEMCMP_PER_BYTE 6.0
+
+#if defined(NATIVE_LIBC) && defined(NATIVE_CALIBRATE)
+#error "NATIVE_CALIBRATE measures the guest routines, so it cannot run with NATIVE_LIBC"
+#endif
+#if (defined(NATIVE_LIBC) || defined(NATIVE_CALIBRATE)) && defined(DECOUPLED_TIMING)
+#error "a native routine emits many cache events per instruction, which DECOUPLED_TIMING cannot carry"
+#endif
+
+/*
+ * The call is caught in the instruction behavior of its delay slot, when
+ * the next PC is the entry of a routine: the next PC becomes the return
+ * address in $ra, so the delay slot still sets up the arguments. When the
+ * return address is reached the routine runs natively with $a0-$a2 and its
+ * result goes to $v0, before the instruction there executes.
+ *
+ * The guest memory is only touched through DM. The data accesses the guest
+ * loop would make (words when the pointers allow it, bytes otherwise) are
+ * added to memAccessCount, and dataCache sees one event per line of each
+ * stream, or one per access while two streams fight for the same row, so
+ * its hits and misses are those of the word loop. The instructions of the
+ * routine (fetches, hazards, branches) are not modeled, only counted.
+ */
+
+enum NativeRoutine {
+  NR_MEMCPY,
+  NR_MEMSET,
+  NR_STRLEN,
+  NR_MEMCMP,
+  NR_ROUTINES
+};
+
+const char *nativeRoutineName[NR_ROUTINES] = { "memcpy", "memset", "strlen", "memcmp" };
+const char *nativeMacroName[NR_ROUTINES] = { "MEMCPY", "MEMSET", "STRLEN", "MEMCMP" };
+
+const double nativeBase[NR_ROUTINES] = {
+  NATIVE_MEMCPY_BASE, NATIVE_MEMSET_BASE, NATIVE_STRLEN_BASE, NATIVE_MEMCMP_BASE
+};
+const double nativePerByte[NR_ROUTINES] = {
+  NATIVE_MEMCPY_PER_BYTE, NATIVE_MEMSET_PER_BYTE, NATIVE_STRLEN_PER_BYTE, NATIVE_MEMCMP_PER_BYTE
+};
+
+typedef struct {
+  unsigned long long calls;
+  unsigned long long bytes;
+  unsigned long long instructions;
+  // least squares of instructions over bytes (NATIVE_CALIBRATE)
+  double sx, sy, sxx, sxy;
+} NativeStats;
+
+typedef struct {
+  bool resolved;
+  unsigned int entry[NR_ROUTINES];   // 0 when the program does not have it
+  int pending;                       // routine waiting for its return address, or -1
+  unsigned int returnAddr;
+  unsigned int units;                // NATIVE_CALIBRATE: bytes of the call being measured
+  unsigned long long startCount;
+  NativeStats stats[NR_ROUTINES];
+} NativeState;
+
+NativeState native[CORES];
+
+// Defined in mips1_isa.cpp
+void verifyCacheRead (int addr, int size);
+void verifyCacheWrite (int addr, int size);
+
+void nativeInit (NativeState &s) {
+  memset(&s, 0, sizeof(s));
+  s.pending = -1;
+}
+
+void nativeResolve (NativeState &s) {
+  s.resolved = true;
+  for (int r = 0; r < NR_ROUTINES; r++) {
+    const ElfSymbol *sym = findElfSymbolByName(nativeRoutineName[r]);
+    s.entry[r] = sym != NULL && sym->isFunction ? sym->addr : 0;
+  }
+}
+
+inline int nativeLookup (NativeState &s, unsigned int pc) {
+  if (!s.resolved)
+    nativeResolve(s);
+  for (int r = 0; r < NR_ROUTINES; r++)
+    if (s.entry[r] == pc && pc != 0)
+      return r;
+  return -1;
+}
+
+// dataCache events of one access stream
+typedef struct {
+  int line;
+  bool write;
+} NativeStream;
+
+inline void nativeTouch (NativeStream &st, const NativeStream &other, unsigned int addr) {
+  int line = addr >> DATA_BLOCK_OFFSET_SIZE_BITS;
+  bool conflict = other.line >= 0 && other.line != line
+                  && ((other.line ^ line) & DATA_ROW_MASK) == 0;
+  if (line == st.line && !conflict)
+    return;
+  st.line = line;
+  if (st.write)
+    verifyCacheWrite(line << DATA_BLOCK_OFFSET_SIZE_BITS, 4);
+  else
+    verifyCacheRead(line << DATA_BLOCK_OFFSET_SIZE_BITS, 4);
+}
+
+// Bytes the routine processes, without touching the models
+template <class Memory>
+unsigned int nativeUnits (Memory &dm, int routine, unsigned int a0, unsigned int a1, unsigned int a2) {
+  unsigned int n = 0;
+  switch (routine) {
+  case NR_STRLEN:
+    while (dm.read_byte(a0 + n) != 0)
+      n++;
+    return n + 1;
+  case NR_MEMCMP:
+    while (n < a2 && dm.read_byte(a0 + n) == dm.read_byte(a1 + n))
+      n++;
+    return n < a2 ? n + 1 : n;
+  default:
+    return a2;
+  }
+}
+
+/*
+ * Runs routine on the guest memory and returns its $v0. accesses gets the
+ * loads and stores of the guest loop.
+ */
+template <class Memory>
+unsigned int nativeRun (Memory &dm, int routine, unsigned int a0, unsigned int a1, unsigned int a2,
+                        unsigned long long &accesses) {
+  NativeStream first = { -1, routine == NR_MEMCPY || routine == NR_MEMSET };
+  NativeStream second = { -1, false };
+  unsigned int i = 0;
+
+  switch (routine) {
+  case NR_MEMCPY:
+    // whole words only when both pointers reach a word boundary together
+    if (((a0 ^ a1) & 3) == 0) {
+      for (; i < a2 && ((a0 + i) & 3) != 0; i++, accesses += 2) {
+        nativeTouch(second, first, a1 + i);
+        nativeTouch(first, second, a0 + i);
+        dm.write_byte(a0 + i, dm.read_byte(a1 + i));
+      }
+      for (; i + 4 <= a2; i += 4, accesses += 2) {
+        nativeTouch(second, first, a1 + i);
+        nativeTouch(first, second, a0 + i);
+        dm.write(a0 + i, dm.read(a1 + i));
+      }
+    }
+    for (; i < a2; i++, accesses += 2) {
+      nativeTouch(second, first, a1 + i);
+      nativeTouch(first, second, a0 + i);
+      dm.write_byte(a0 + i, dm.read_byte(a1 + i));
+    }
+    return a0;
+
+  case NR_MEMSET: {
+    unsigned char c = a1;
+    unsigned int word = c * 0x01010101u;
+    for (; i < a2 && ((a0 + i) & 3) != 0; i++, accesses++) {
+      nativeTouch(first, second, a0 + i);
+      dm.write_byte(a0 + i, c);
+    }
+    for (; i + 4 <= a2; i += 4, accesses++) {
+      nativeTouch(first, second, a0 + i);
+      dm.write(a0 + i, word);
+    }
+    for (; i < a2; i++, accesses++) {
+      nativeTouch(first, second, a0 + i);
+      dm.write_byte(a0 + i, c);
+    }
+    return a0;
+  }
+
+  case NR_STRLEN:
+    for (;; i++) {
+      accesses++;
+      nativeTouch(first, second, a0 + i);
+      if (dm.read_byte(a0 + i) == 0)
+        return i;
+    }
+
+  case NR_MEMCMP:
+    for (; i < a2; i++) {
+      accesses += 2;
+      nativeTouch(first, second, a0 + i);
+      nativeTouch(second, first, a1 + i);
+      int b0 = dm.read_byte(a0 + i), b1 = dm.read_byte(a1 + i);
+      if (b0 != b1)
+        return (unsigned int) (b0 - b1);
+    }
+    return 0;
+  }
+  return 0;
+}
+
+/*
+ * Called by the instruction behavior with the next PC: true when it is the
+ * entry of a native routine and the caller must jump to returnAddr instead.
+ */
+inline bool nativeRedirect (NativeState &s, unsigned int target, unsigned int returnAddr) {
+  int r = nativeLookup(s, target);
+  if (r < 0)
+    return false;
+  s.pending = r;
+  s.returnAddr = returnAddr;
+  return true;
+}
+
+// Runs the pending routine; instructions and memAccesses get its share
+template <class Memory>
+unsigned int nativeCall (NativeState &s, Memory &dm, unsigned int a0, unsigned int a1, unsigned int a2,
+                         unsigned long long &instructions, unsigned long long &memAccesses) {
+  int r = s.pending;
+  s.pending = -1;
+
+  unsigned int units = nativeUnits(dm, r, a0, a1, a2);
+  unsigned int v0 = nativeRun(dm, r, a0, a1, a2, memAccesses);
+  int charged = (int) (nativeBase[r] + nativePerByte[r] * units + 0.5);
+  instructions += charged;
+
+  NativeStats &st = s.stats[r];
+  st.calls++;
+  st.bytes += units;
+  st.instructions += charged;
+  return v0;
+}
+
+/*
+ * NATIVE_CALIBRATE: called by the instruction behavior with the PC of the
+ * instruction starting and the instructions counted before it.
+ */
+template <class Memory>
+void nativeMeasure (NativeState &s, Memory &dm, unsigned int pc, unsigned int a0, unsigned int a1,
+                    unsigned int a2, unsigned int ra, unsigned long long instructionCount) {
+  if (s.pending >= 0) {
+    if (pc != s.returnAddr)
+      return;
+    NativeStats &st = s.stats[s.pending];
+    double x = s.units, y = instructionCount - s.startCount;
+    st.calls++;
+    st.bytes += s.units;
+    st.instructions += instructionCount - s.startCount;
+    st.sx += x;
+    st.sy += y;
+    st.sxx += x * x;
+    st.sxy += x * y;
+    s.pending = -1;
+  }
+
+  int r = nativeLookup(s, pc);
+  if (r < 0)
+    return;
+  s.pending = r;
+  s.returnAddr = ra;
+  s.units = nativeUnits(dm, r, a0, a1, a2);
+  s.startCount = instructionCount;
+}
+
+void nativeReport () {
+  printf("\n\n******************** NATIVE LIBC ROUTINES ***********************\n");
+  for (int c = 0; c < CORES; c++) {
+    const NativeState &s = native[c];
+    if (CORES > 1)
+      printf("core %d:\n", c);
+    for (int r = 0; r < NR_ROUTINES; r++) {
+      const NativeStats &st = s.stats[r];
+      if (s.entry[r] == 0) {
+        printf("- %s: not in the program\n", nativeRoutineName[r]);
+        continue;
+      }
+      printf("- %s at %#x: %llu calls, %llu bytes, %llu instructions\n", nativeRoutineName[r], s.entry[r],
+             st.calls, st.bytes, st.instructions);
+#ifdef NATIVE_CALIBRATE
+      double d = st.calls * st.sxx - st.sx * st.sx;
+      if (st.calls > 1 && d != 0) {
+        double perByte = (st.calls * st.sxy - st.sx * st.sy) / d;
+        printf("  fit: NATIVE_%s_BASE %.1lf, NATIVE_%s_PER_BYTE %.3lf\n", nativeMacroName[r],
+               (st.sy - perByte * st.sx) / st.calls, nativeMacroName[r], perByte);
+      }
+#endif
+    }
+  }
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
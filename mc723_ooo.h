@@ -0,0 +1,347 @@
+#ifndef _MC723_OOO_H
+#define _MC723_OOO_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "mc723.h"
+
+/************** Out-of-order timing model ****************/
+
+// Uncomment to run every instruction through an out-of-order core model
+// (reorder buffer, issue queue, load/store queue) and compare its cycles
+// with the in-order pipeline whose stalls hazardCount reports
+//#define OOO_MODEL
+
+// Dispatch, issue and commit width
+#define OOO_WIDTH 2
+// Entries; powers of two, at most 64 (one bit each in the wakeup masks)
+#define OOO_ROB_SIZE 32
+#define OOO_IQ_SIZE 16
+#define OOO_LSQ_SIZE 16
+
+#define OOO_LOAD_CYCLES 2
+#define OOO_FORWARD_CYCLES 1      // store-to-load forwarding
+#define OOO_MISS_CYCLES 20        // added to a load that missed dataCache
+#define OOO_REDIRECT_CYCLES 3     // refetch after a mispredicted branch resolves
+
+#if OOO_ROB_SIZE > 64 || OOO_IQ_SIZE > 64 || OOO_LSQ_SIZE > 64
+#error "OOO_ROB_SIZE, OOO_IQ_SIZE and OOO_LSQ_SIZE must be at most 64"
+#endif
+#if defined(OOO_MODEL) && defined(DECOUPLED_TIMING)
+#error "OOO_MODEL takes the effective addresses from the behaviors and cannot run with DECOUPLED_TIMING"
+#endif
+
+// Completion wheel: more slots than the longest latency
+#define OOO_WHEEL 64
+#if OOO_LOAD_CYCLES + OOO_MISS_CYCLES >= OOO_WHEEL
+#error "OOO_WHEEL must exceed the longest latency"
+#endif
+
+/*
+ * The behaviors describe each instruction in an OooRecord (registers from
+ * createContext, effective address from Type_I_MEMREAD/MEMWRITE); the data
+ * miss, instruction fetch miss and mispredict outcomes are the changes of
+ * the existing counters while it executed. The record is dispatched when
+ * the next instruction starts.
+ *
+ * The core is cycle driven: dispatch stalls until the ROB, issue queue and
+ * LSQ have room; each cycle completes the instructions in the wheel slot,
+ * wakes their consumers by clearing bits of the issue queue masks, commits
+ * in order and issues up to OOO_WIDTH ready instructions. Issue picks the
+ * lowest ready slots, not strictly the oldest. HI/LO are not renamed.
+ */
+
+enum OooKind {
+  OOO_ALU,
+  OOO_LOAD,
+  OOO_STORE
+};
+
+typedef struct {
+  signed char dest, src1, src2;
+  unsigned char kind;
+  unsigned int addr;
+  bool dataMiss, fetchMiss, mispredict;
+} OooRecord;
+
+typedef struct {
+  bool completed;
+  bool forward;            // load fed by an older store in the LSQ
+  bool dataMiss;
+  unsigned char kind;
+  signed char dest;
+  unsigned int word;       // effective address >> 2
+  uint64_t consumers;      // issue queue slots waiting for this entry
+} OooRobEntry;
+
+typedef struct {
+  OooRobEntry rob[OOO_ROB_SIZE];
+  int robHead, robCount;
+
+  int iqRob[OOO_IQ_SIZE];
+  unsigned char iqPending[OOO_IQ_SIZE];
+  uint64_t iqFree, iqReady;
+
+  int lsqRob[OOO_LSQ_SIZE];   // loads and stores in program order
+  int lsqHead, lsqCount;
+
+  int regProducer[32];        // ROB entry writing each register, or -1
+  uint64_t wheel[OOO_WHEEL];  // ROB entries completing at each cycle
+
+  unsigned long long cycle;
+  unsigned long long fetchResume;
+  int dispatched;
+  int blockedBy;              // mispredicted branch not resolved yet
+
+  unsigned long long instructions;
+  unsigned long long loads, stores, forwards, memoryWaits;
+  unsigned long long mispredicts;
+  unsigned long long fetchStalls, robFull, iqFull, lsqFull, idleIssue;
+} OooCore;
+
+OooCore oooCore[CORES];
+
+// Instruction being described and the core running it
+OooRecord oooRecord;
+int oooRecordCore = -1;
+unsigned long long oooLastDataMiss, oooLastInstructionMiss, oooLastMispredict;
+
+#define OOO_BIT(N) ((uint64_t) 1 << (N))
+#define OOO_MASK(N) ((N) == 64 ? ~(uint64_t) 0 : OOO_BIT(N) - 1)
+
+void oooInit (OooCore &m) {
+  memset(&m, 0, sizeof(m));
+  m.iqFree = OOO_MASK(OOO_IQ_SIZE);
+  for (int r = 0; r < 32; r++)
+    m.regProducer[r] = -1;
+  m.blockedBy = -1;
+}
+
+void oooCycle (OooCore &m) {
+  // complete and wake up the consumers
+  uint64_t done = m.wheel[m.cycle % OOO_WHEEL];
+  m.wheel[m.cycle % OOO_WHEEL] = 0;
+  while (done) {
+    int r = __builtin_ctzll(done);
+    done &= done - 1;
+
+    OooRobEntry &e = m.rob[r];
+    e.completed = true;
+    uint64_t consumers = e.consumers;
+    e.consumers = 0;
+    while (consumers) {
+      int s = __builtin_ctzll(consumers);
+      consumers &= consumers - 1;
+      if (--m.iqPending[s] == 0)
+        m.iqReady |= OOO_BIT(s);
+    }
+
+    if (m.blockedBy == r) {
+      m.blockedBy = -1;
+      if (m.fetchResume < m.cycle + OOO_REDIRECT_CYCLES)
+        m.fetchResume = m.cycle + OOO_REDIRECT_CYCLES;
+    }
+  }
+
+  // commit in order
+  for (int n = 0; n < OOO_WIDTH && m.robCount > 0 && m.rob[m.robHead].completed; n++) {
+    OooRobEntry &e = m.rob[m.robHead];
+    if (e.kind != OOO_ALU) {
+      m.lsqHead = (m.lsqHead + 1) & (OOO_LSQ_SIZE - 1);
+      m.lsqCount--;
+    }
+    if (e.dest > 0 && m.regProducer[(int) e.dest] == m.robHead)
+      m.regProducer[(int) e.dest] = -1;
+    m.robHead = (m.robHead + 1) & (OOO_ROB_SIZE - 1);
+    m.robCount--;
+  }
+
+  // issue
+  int issued = 0;
+  while (m.iqReady && issued < OOO_WIDTH) {
+    int s = __builtin_ctzll(m.iqReady);
+    m.iqReady &= m.iqReady - 1;
+    m.iqFree |= OOO_BIT(s);
+
+    int r = m.iqRob[s];
+    const OooRobEntry &e = m.rob[r];
+    int latency = 1;
+    if (e.kind == OOO_LOAD)
+      latency = e.forward ? OOO_FORWARD_CYCLES : OOO_LOAD_CYCLES + (e.dataMiss ? OOO_MISS_CYCLES : 0);
+    m.wheel[(m.cycle + latency) % OOO_WHEEL] |= OOO_BIT(r);
+    issued++;
+  }
+  if (issued == 0 && m.robCount > 0)
+    m.idleIssue++;
+
+  m.cycle++;
+  m.dispatched = 0;
+}
+
+void oooDispatch (OooCore &m, const OooRecord &rec) {
+  bool memory = rec.kind != OOO_ALU;
+
+  for (;;) {
+    if (m.cycle < m.fetchResume || m.blockedBy >= 0)
+      m.fetchStalls++;
+    else if (m.robCount == OOO_ROB_SIZE)
+      m.robFull++;
+    else if (m.iqFree == 0)
+      m.iqFull++;
+    else if (memory && m.lsqCount == OOO_LSQ_SIZE)
+      m.lsqFull++;
+    else if (m.dispatched < OOO_WIDTH)
+      break;
+    oooCycle(m);
+  }
+
+  int r = (m.robHead + m.robCount) & (OOO_ROB_SIZE - 1);
+  m.robCount++;
+  OooRobEntry &e = m.rob[r];
+  e.completed = false;
+  e.forward = false;
+  e.dataMiss = rec.dataMiss;
+  e.kind = rec.kind;
+  e.dest = rec.dest;
+  e.word = rec.addr >> 2;
+  e.consumers = 0;
+
+  int s = __builtin_ctzll(m.iqFree);
+  m.iqFree &= ~OOO_BIT(s);
+  m.iqRob[s] = r;
+  int pending = 0;
+
+  // register dependencies (r0 and NOT_USED never wait)
+  int src[2] = { rec.src1, rec.src2 };
+  for (int i = 0; i < 2; i++) {
+    if (src[i] <= 0 || (i == 1 && src[1] == src[0]))
+      continue;
+    int p = m.regProducer[src[i]];
+    if (p >= 0 && !m.rob[p].completed && !(m.rob[p].consumers & OOO_BIT(s))) {
+      m.rob[p].consumers |= OOO_BIT(s);
+      pending++;
+    }
+  }
+
+  // the youngest older store to the same word feeds the load
+  if (rec.kind == OOO_LOAD) {
+    m.loads++;
+    for (int i = m.lsqCount - 1; i >= 0; i--) {
+      OooRobEntry &st = m.rob[m.lsqRob[(m.lsqHead + i) & (OOO_LSQ_SIZE - 1)]];
+      if (st.kind != OOO_STORE || st.word != e.word)
+        continue;
+      e.forward = true;
+      m.forwards++;
+      if (!st.completed) {
+        st.consumers |= OOO_BIT(s);
+        pending++;
+        m.memoryWaits++;
+      }
+      break;
+    }
+  } else if (rec.kind == OOO_STORE) {
+    m.stores++;
+  }
+
+  if (memory) {
+    m.lsqRob[(m.lsqHead + m.lsqCount) & (OOO_LSQ_SIZE - 1)] = r;
+    m.lsqCount++;
+  }
+  if (rec.dest > 0)
+    m.regProducer[(int) rec.dest] = r;
+
+  m.iqPending[s] = pending;
+  if (pending == 0)
+    m.iqReady |= OOO_BIT(s);
+
+  if (rec.mispredict) {
+    m.blockedBy = r;
+    m.mispredicts++;
+  }
+  // the instruction cache missed fetching the next instruction
+  if (rec.fetchMiss && m.fetchResume < m.cycle + OOO_MISS_CYCLES)
+    m.fetchResume = m.cycle + OOO_MISS_CYCLES;
+
+  m.dispatched++;
+  m.instructions++;
+}
+
+/*
+ * Called when an instruction of core starts, before its fetch is checked:
+ * dispatches the previous instruction (of whatever core ran it) with the
+ * counter changes it caused, and opens the record of the new one.
+ */
+void oooNext (int core, unsigned long long dataMisses, unsigned long long instructionMisses,
+              unsigned long long mispredicts) {
+  if (oooRecordCore >= 0) {
+    oooRecord.dataMiss = dataMisses != oooLastDataMiss;
+    oooRecord.fetchMiss = instructionMisses != oooLastInstructionMiss;
+    oooRecord.mispredict = mispredicts != oooLastMispredict;
+    oooDispatch(oooCore[oooRecordCore], oooRecord);
+  }
+  oooLastDataMiss = dataMisses;
+  oooLastInstructionMiss = instructionMisses;
+  oooLastMispredict = mispredicts;
+
+  oooRecordCore = core;
+  oooRecord.dest = oooRecord.src1 = oooRecord.src2 = NOT_USED;
+  oooRecord.kind = OOO_ALU;
+  oooRecord.addr = 0;
+}
+
+inline void oooContext (int r_dest, int r_read1, int r_read2) {
+  oooRecord.dest = r_dest;
+  oooRecord.src1 = r_read1;
+  oooRecord.src2 = r_read2;
+}
+
+inline void oooMemory (unsigned int addr, bool store) {
+  oooRecord.kind = store ? OOO_STORE : OOO_LOAD;
+  oooRecord.addr = addr;
+}
+
+// Dispatches the last instruction and drains the cores
+void oooFinish (unsigned long long dataMisses, unsigned long long instructionMisses,
+                unsigned long long mispredicts) {
+  oooNext(-1, dataMisses, instructionMisses, mispredicts);
+  oooRecordCore = -1;
+  for (int c = 0; c < CORES; c++)
+    while (oooCore[c].robCount > 0)
+      oooCycle(oooCore[c]);
+}
+
+void oooReport (unsigned long long instructions, unsigned long long hazards, unsigned long long dataMisses,
+                unsigned long long instructionMisses, unsigned long long mispredicts) {
+  printf("\n\n********************** OUT-OF-ORDER CORE ************************\n");
+  printf("- width %d, ROB %d, issue queue %d, LSQ %d\n", OOO_WIDTH, OOO_ROB_SIZE, OOO_IQ_SIZE, OOO_LSQ_SIZE);
+
+  unsigned long long cycles = 0;
+  for (int c = 0; c < CORES; c++) {
+    const OooCore &m = oooCore[c];
+    if (m.instructions == 0)
+      continue;
+    if (CORES > 1)
+      printf("core %d:\n", c);
+    printf("  %llu instructions in %llu cycles, IPC %.3lf\n", m.instructions, m.cycle,
+           m.cycle ? (double) m.instructions / m.cycle : 0.0);
+    printf("  loads %llu (%llu forwarded, %llu waited for a store), stores %llu, mispredicts %llu\n",
+           m.loads, m.forwards, m.memoryWaits, m.stores, m.mispredicts);
+    printf("  dispatch stall cycles: fetch %llu, ROB full %llu, IQ full %llu, LSQ full %llu; no issue %llu\n",
+           m.fetchStalls, m.robFull, m.iqFull, m.lsqFull, m.idleIssue);
+    if (m.cycle > cycles)
+      cycles = m.cycle;
+  }
+
+  // same penalties on a single-issue in-order pipeline
+  unsigned long long base = instructions + mispredicts * OOO_REDIRECT_CYCLES
+                          + (dataMisses + instructionMisses) * OOO_MISS_CYCLES;
+  printf("- in-order: %llu cycles, of which %llu load-use stalls (hazardCount); without them %llu\n",
+         base + hazards, hazards, base);
+  printf("- out-of-order speedup over in-order: %.3lf\n", cycles ? (double) (base + hazards) / cycles : 0.0);
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
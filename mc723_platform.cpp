@@ -0,0 +1,76 @@
+// Platform with CORES mips1 instances for the MESI model of
+// mc723_coherence.h; it replaces the main.cpp generated by acsim (see
+// 'make multicore').
+//
+//   ./mips1.x --load=prog args                  every core runs prog
+//   ./mips1.x --load=prog1 args + --load=prog2  one command line per core,
+//                                               the last one is repeated
+//
+// CORES comes from the command line (-DCORES=N), the same for main.cpp
+// and mips1_isa.cpp.
+
+const char *project_name="mips1";
+const char *project_file="mips1.ac";
+const char *archc_version="2.2";
+const char *archc_options="-abi ";
+
+#include  <systemc.h>
+#include  <string.h>
+#include  <vector>
+#include  "mips1.H"
+
+// mips1_isa.cpp must see the same CORES, or every instance shares one set
+// of caches, predictors and counters
+#ifndef CORES
+#error "build with -DCORES=N (make multicore)"
+#endif
+
+int sc_main(int ac, char *av[])
+{
+  // split the arguments at "+", keeping av[0] in front of each command line
+  std::vector< std::vector<char *> > lines(1, std::vector<char *>(1, av[0]));
+  for (int i = 1; i < ac; i++) {
+    if (strcmp(av[i], "+") == 0 && (int) lines.size() < CORES)
+      lines.push_back(std::vector<char *>(1, av[0]));
+    else
+      lines.back().push_back(av[i]);
+  }
+  // the simulator may keep the pointers, so the lines live until the end
+  for (size_t l = 0; l < lines.size(); l++)
+    lines[l].push_back(NULL);
+
+  //!  ISA simulators
+  mips1 *proc[CORES];
+  for (int c = 0; c < CORES; c++) {
+    char name[32];
+    sprintf(name, "mips1_proc%d", c);
+    proc[c] = new mips1(name);
+  }
+
+#ifdef AC_DEBUG
+  ac_trace("mips1_proc0.trace");
+#endif
+
+  // init runs the begin behavior, which registers the instance as a core
+  for (int c = 0; c < CORES; c++) {
+    std::vector<char *> &args = lines[c < (int) lines.size() ? c : lines.size() - 1];
+    proc[c]->init(args.size() - 1, &args[0]);
+  }
+  cerr << endl;
+
+  sc_start();
+
+  int status = 0;
+  for (int c = 0; c < CORES; c++) {
+    proc[c]->PrintStat();
+    if (proc[c]->ac_exit_status != 0)
+      status = proc[c]->ac_exit_status;
+  }
+  cerr << endl;
+
+#ifdef AC_DEBUG
+  ac_close_trace();
+#endif
+
+  return status;
+}
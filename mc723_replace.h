@@ -0,0 +1,148 @@
+#ifndef _MC723_REPLACE_H
+#define _MC723_REPLACE_H
+
+#include <stdio.h>
+#include <vector>
+#include <tr1/unordered_map>
+#include "mc723.h"
+#include "mc723_assoc.h"
+
+/************** Replacement policies ****************/
+
+// Uncomment to run set-associative copies of dataCache and instructionCache
+// (same capacity and line size) under every replacement policy of
+// mc723_assoc.h, plus Belady's OPT computed offline at the end
+//#define REPLACEMENT_STUDY
+
+#define REPLACE_WAYS 4
+
+// The access stream kept for OPT, 8 bytes per access with the next-use
+// pass; OPT and its comparison rows cover only the first
+// REPLACE_OPT_MAX_ACCESSES accesses
+#define REPLACE_OPT_MAX_ACCESSES (1 << 26)
+
+#if defined(REPLACEMENT_STUDY) && defined(DECOUPLED_TIMING) && TIMING_THREADS > 1
+#error "REPLACEMENT_STUDY keeps one access stream per cache, so it needs a single timing thread"
+#endif
+
+/*
+ * Every online policy sees the accesses as they happen. The stream is
+ * recorded as line numbers with the write flag in bit 31; at the end one
+ * backward pass gives the index of the next access to each line, and the
+ * stream is replayed on an OPT cache that evicts the line used farthest in
+ * the future (demand fills, no bypass).
+ */
+
+#define REPLACE_WRITE 0x80000000u
+
+typedef struct {
+  const char *name;
+  unsigned int lineBits;
+  unsigned int lines;
+  AssocCache policy[ASSOC_OPT];           // the online policies
+  std::vector<unsigned int> stream;
+  // misses + writebacks of each policy when the stream filled up
+  unsigned long long prefixMisses[ASSOC_OPT];
+  bool truncated;
+} ReplaceStudy;
+
+ReplaceStudy dataReplace[CORES];
+ReplaceStudy instructionReplace[CORES];
+
+void replaceInit (ReplaceStudy &m, const char *name, unsigned int lines, unsigned int lineBits) {
+  m.name = name;
+  m.lines = lines;
+  m.lineBits = lineBits;
+  for (int p = 0; p < ASSOC_OPT; p++) {
+    assocInit(m.policy[p], lines, REPLACE_WAYS, lineBits, (AssocPolicy) p);
+    m.prefixMisses[p] = 0;
+  }
+  m.stream.clear();
+  m.truncated = false;
+}
+
+inline void replaceAccess (ReplaceStudy &m, unsigned int addr, bool write, unsigned int pc) {
+  bool hit;
+  for (int p = 0; p < ASSOC_OPT; p++)
+    assocAccess(m.policy[p], addr, write, hit, pc);
+
+  if (m.truncated)
+    return;
+  if (m.stream.size() == REPLACE_OPT_MAX_ACCESSES) {
+    m.truncated = true;
+    for (int p = 0; p < ASSOC_OPT; p++)
+      m.prefixMisses[p] = m.policy[p].misses + m.policy[p].writebacks;
+    return;
+  }
+  m.stream.push_back((addr >> m.lineBits) | (write ? REPLACE_WRITE : 0));
+}
+
+// Replays the recorded stream on an OPT cache, returns misses + writebacks
+unsigned long long replaceOpt (const ReplaceStudy &m) {
+  size_t n = m.stream.size();
+  std::vector<unsigned int> nextUse(n);
+  std::tr1::unordered_map<unsigned int, unsigned int> seen;
+  for (size_t i = n; i-- > 0; ) {
+    unsigned int line = m.stream[i] & ~REPLACE_WRITE;
+    std::tr1::unordered_map<unsigned int, unsigned int>::iterator it = seen.find(line);
+    if (it == seen.end()) {
+      nextUse[i] = ASSOC_NEVER;
+      seen[line] = i;
+    } else {
+      nextUse[i] = it->second;
+      it->second = i;
+    }
+  }
+
+  AssocCache opt;
+  assocInit(opt, m.lines, REPLACE_WAYS, m.lineBits, ASSOC_OPT);
+  bool hit;
+  for (size_t i = 0; i < n; i++) {
+    unsigned int line = m.stream[i] & ~REPLACE_WRITE;
+    assocAccess(opt, line << m.lineBits, (m.stream[i] & REPLACE_WRITE) != 0, hit, 0, nextUse[i]);
+  }
+  return opt.misses + opt.writebacks;
+}
+
+/*
+ * dmMisses are the misses (+ writebacks for the data cache) of the
+ * direct-mapped cache, the "replace on tag mismatch" baseline.
+ */
+void replacePrint (ReplaceStudy &m, unsigned long long dmMisses) {
+  if (m.policy[ASSOC_LRU].accesses == 0)
+    return;
+
+  unsigned long long opt = replaceOpt(m);
+  printf("- %s, %u lines of %u bytes, %d ways, %llu accesses", m.name, m.lines, 1 << m.lineBits,
+         REPLACE_WAYS, m.policy[ASSOC_LRU].accesses);
+  if (m.truncated)
+    printf(" (OPT over the first %d)", REPLACE_OPT_MAX_ACCESSES);
+  printf("\n  %-14s %12s %12s %12s\n", "policy", "misses+wb", "vs OPT", "OPT prefix");
+  if (m.truncated)
+    printf("  %-14s %12llu\n", "direct-mapped", dmMisses);
+  else
+    printf("  %-14s %12llu %11.2lf%%\n", "direct-mapped", dmMisses, opt ? 100.0 * dmMisses / opt - 100.0 : 0.0);
+  for (int p = 0; p < ASSOC_OPT; p++) {
+    const AssocCache &c = m.policy[p];
+    unsigned long long prefix = m.truncated ? m.prefixMisses[p] : c.misses + c.writebacks;
+    printf("  %-14s %12llu %11.2lf%% %12llu\n", assocPolicyName[p], c.misses + c.writebacks,
+           opt ? 100.0 * prefix / opt - 100.0 : 0.0, prefix);
+  }
+  printf("  %-14s %12s %12s %12llu\n", assocPolicyName[ASSOC_OPT], "", "", opt);
+}
+
+void replaceReport (unsigned long long dataMisses, unsigned long long instructionMisses) {
+  printf("\n\n******************** REPLACEMENT POLICIES ***********************\n");
+  for (int c = 0; c < CORES; c++) {
+    if (CORES > 1)
+      printf("core %d:\n", c);
+    // the direct-mapped counts are global, so they only make sense with one core
+    replacePrint(dataReplace[c], CORES == 1 ? dataMisses : 0);
+    replacePrint(instructionReplace[c], CORES == 1 ? instructionMisses : 0);
+  }
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef _MC723_REUSE_H
+#define _MC723_REUSE_H
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include <tr1/unordered_map>
+#include "mc723.h"
+
+/************** Reuse distance / working set ****************/
+
+// Uncomment to characterize the locality of the load/store stream
+//#define REUSE_DISTANCE
+
+// log2 of the line size used to group addresses (4 = the 16 bytes of the data cache)
+#define REUSE_LINE_BITS 4
+
+// Number of accesses in each working-set interval
+#define REUSE_INTERVAL 1000000
+
+// Per-interval working-set sizes are written here (one line per interval)
+#define REUSE_WORKING_SET_FILE "../workingset.txt"
+
+// Initial number of timestamps in the Fenwick tree; it is compacted (and
+// grown if the footprint needs it) whenever the timestamps run out
+#define REUSE_INITIAL_CAPACITY (1 << 20)
+
+// Histogram buckets: 0 holds distance 0, bucket b holds [2^(b-1), 2^b)
+#define REUSE_BUCKETS 33
+
+#if CORES > 1 && defined(REUSE_DISTANCE)
+#error "REUSE_DISTANCE keeps a single access clock and cannot tell the cores apart"
+#endif
+
+/*
+ * The reuse distance of an access is the number of distinct lines touched
+ * since the previous access to the same line. Every line keeps a marker
+ * at the timestamp of its last access in a Fenwick tree, so the distance
+ * is the number of markers after that timestamp: O(log n) per access.
+ */
+
+typedef struct {
+  unsigned int time;
+  unsigned int interval;
+} ReuseLine;
+
+typedef std::tr1::unordered_map<unsigned int, ReuseLine> ReuseMap;
+
+ReuseMap reuseLines;
+std::vector<int> reuseTree;
+unsigned int reuseCapacity;
+unsigned int reuseNow;
+
+unsigned long long reuseHistogram[REUSE_BUCKETS];
+unsigned long long reuseColdCount;
+unsigned long long reuseAccessCount;
+
+unsigned int reuseInterval;
+unsigned int reuseIntervalAccesses;
+unsigned int reuseIntervalLines;
+unsigned long long reuseWorkingSetHistogram[REUSE_BUCKETS];
+unsigned int reuseWorkingSetMax;
+unsigned long long reuseWorkingSetSum;
+FILE *reuseWorkingSetFile;
+
+void reuseTreeAdd (unsigned int i, int v) {
+  for (i++; i <= reuseCapacity; i += i & -i)
+    reuseTree[i] += v;
+}
+
+// number of markers in [0, i]
+int reuseTreeSum (unsigned int i) {
+  int s = 0;
+  for (i++; i > 0; i -= i & -i)
+    s += reuseTree[i];
+  return s;
+}
+
+int reuseBucket (unsigned long long v) {
+  int b = 0;
+  while (v != 0) {
+    v >>= 1;
+    b++;
+  }
+  return b;
+}
+
+bool reuseTimeLess (const std::pair<unsigned int, unsigned int> &a,
+                    const std::pair<unsigned int, unsigned int> &b) {
+  return a.first < b.first;
+}
+
+// Renumbers the live markers 0..lines-1, keeping their order
+void reuseCompact () {
+  std::vector<std::pair<unsigned int, unsigned int> > order;
+  order.reserve(reuseLines.size());
+  for (ReuseMap::iterator it = reuseLines.begin(); it != reuseLines.end(); ++it)
+    order.push_back(std::make_pair(it->second.time, it->first));
+  std::sort(order.begin(), order.end(), reuseTimeLess);
+
+  while (order.size() * 2 > reuseCapacity)
+    reuseCapacity *= 2;
+
+  reuseTree.assign(reuseCapacity + 1, 0);
+  for (unsigned int t = 0; t < order.size(); t++) {
+    reuseLines[order[t].second].time = t;
+    reuseTreeAdd(t, 1);
+  }
+  reuseNow = order.size();
+}
+
+void reuseEndInterval () {
+  if (reuseIntervalAccesses == 0)
+    return;
+
+  reuseWorkingSetHistogram[reuseBucket(reuseIntervalLines)]++;
+  reuseWorkingSetSum += reuseIntervalLines;
+  if (reuseIntervalLines > reuseWorkingSetMax)
+    reuseWorkingSetMax = reuseIntervalLines;
+  if (reuseWorkingSetFile != NULL)
+    fprintf(reuseWorkingSetFile, "%u %u\n", reuseInterval, reuseIntervalLines);
+
+  reuseInterval++;
+  reuseIntervalAccesses = 0;
+  reuseIntervalLines = 0;
+}
+
+void reuseInit () {
+  reuseLines.clear();
+  reuseCapacity = REUSE_INITIAL_CAPACITY;
+  reuseTree.assign(reuseCapacity + 1, 0);
+  reuseNow = 0;
+
+  for (int b = 0; b < REUSE_BUCKETS; b++) {
+    reuseHistogram[b] = 0;
+    reuseWorkingSetHistogram[b] = 0;
+  }
+  reuseColdCount = 0;
+  reuseAccessCount = 0;
+
+  // interval numbers start at 1 so that 0 means "never touched"
+  reuseInterval = 1;
+  reuseIntervalAccesses = 0;
+  reuseIntervalLines = 0;
+  reuseWorkingSetMax = 0;
+  reuseWorkingSetSum = 0;
+  reuseWorkingSetFile = fopen(REUSE_WORKING_SET_FILE, "w");
+}
+
+void reuseAccess (unsigned int addr) {
+  unsigned int line = addr >> REUSE_LINE_BITS;
+
+  if (reuseNow == reuseCapacity)
+    reuseCompact();
+
+  std::pair<ReuseMap::iterator, bool> ins = reuseLines.insert(std::make_pair(line, ReuseLine()));
+  ReuseLine &entry = ins.first->second;
+
+  if (ins.second) {
+    reuseColdCount++;
+    entry.interval = 0;
+  } else {
+    int distance = reuseTreeSum(reuseNow - 1) - reuseTreeSum(entry.time);
+    reuseHistogram[reuseBucket(distance)]++;
+    reuseTreeAdd(entry.time, -1);
+  }
+
+  entry.time = reuseNow;
+  reuseTreeAdd(reuseNow, 1);
+  reuseNow++;
+
+  if (entry.interval != reuseInterval) {
+    entry.interval = reuseInterval;
+    reuseIntervalLines++;
+  }
+  reuseAccessCount++;
+  if (++reuseIntervalAccesses == REUSE_INTERVAL)
+    reuseEndInterval();
+}
+
+void reuseReport () {
+  reuseEndInterval();
+  if (reuseWorkingSetFile != NULL)
+    fclose(reuseWorkingSetFile);
+
+  unsigned int lineSize = 1 << REUSE_LINE_BITS;
+  printf("\n\n********************** REUSE DISTANCE ***************************\n");
+  printf("- accesses: %llu, line size: %u bytes, footprint: %u lines (%u KB)\n",
+         reuseAccessCount, lineSize, (unsigned int) reuseLines.size(),
+         (unsigned int) (reuseLines.size() * lineSize / 1024));
+  printf("- cold (first touch): %llu\n", reuseColdCount);
+
+  // an access hits in a fully associative LRU cache of S lines iff its
+  // distance is < S, so the cumulative histogram is the miss curve
+  printf("\n  %-24s %14s %10s %22s\n", "distance (lines)", "accesses", "%", "miss ratio FA-LRU <=");
+  unsigned long long cumulative = 0;
+  int last = 0;
+  for (int b = 0; b < REUSE_BUCKETS; b++)
+    if (reuseHistogram[b] != 0)
+      last = b;
+  for (int b = 0; b <= last; b++) {
+    unsigned long long lo = b == 0 ? 0 : 1ULL << (b - 1);
+    unsigned long long hi = b == 0 ? 0 : (1ULL << b) - 1;
+    cumulative += reuseHistogram[b];
+    char range[32];
+    snprintf(range, sizeof(range), "[%llu, %llu]", lo, hi);
+    printf("  %-24s %14llu %9.4lf%% %10llu lines %.4lf\n", range, reuseHistogram[b],
+           100.0 * reuseHistogram[b] / (double) reuseAccessCount, hi + 1,
+           (double) (reuseAccessCount - cumulative) / (double) reuseAccessCount);
+  }
+
+  unsigned int intervals = reuseInterval - 1;
+  printf("\n- working set per %d accesses: %u intervals, avg %.1lf lines, max %u lines\n",
+         REUSE_INTERVAL, intervals, intervals ? (double) reuseWorkingSetSum / intervals : 0.0,
+         reuseWorkingSetMax);
+  for (int b = 0; b < REUSE_BUCKETS; b++) {
+    if (reuseWorkingSetHistogram[b] == 0)
+      continue;
+    printf("  [%llu, %llu] lines: %llu intervals\n", b == 0 ? 0 : 1ULL << (b - 1),
+           b == 0 ? 0 : (1ULL << b) - 1, reuseWorkingSetHistogram[b]);
+  }
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
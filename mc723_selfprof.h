@@ -0,0 +1,279 @@
+#ifndef _MC723_SELFPROF_H
+#define _MC723_SELFPROF_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/************** Simulator self-profiling ****************/
+
+// Uncomment to sample where the host time of the simulator goes: host
+// cycles, instructions and cache misses per subsystem of this file
+//#define SELF_PROFILE
+
+// Overflow periods of the perf_event_open counters
+#define SELF_PROFILE_CYCLES_PERIOD 1000000
+#define SELF_PROFILE_INSTRUCTIONS_PERIOD 1000000
+#define SELF_PROFILE_MISSES_PERIOD 10000
+
+// Overflow signal: real-time, so simultaneous overflows queue instead of
+// merging (a lost signal would leave its counter disabled)
+#define SELF_PROFILE_SIGNAL (SIGRTMIN + 3)
+
+// Without hardware counters: rdtsc read by a SIGPROF timer at this rate
+#define SELF_PROFILE_HZ 2000
+
+#if defined(SELF_PROFILE) && defined(DECOUPLED_TIMING)
+#error "SELF_PROFILE attributes samples to the subsystem of the main thread; the models run on the timing threads with DECOUPLED_TIMING"
+#endif
+
+/*
+ * Each instrumented function marks its subsystem in selfProfileState on
+ * entry and restores the previous one on exit (two stores, no counter
+ * reads). The counters overflow every period and signal the process; the
+ * handler adds one period to the subsystem running at that moment, which
+ * is how perf record attributes samples. Without perf_event_open (no PMU
+ * in a VM, perf_event_paranoid) the SIGPROF timer adds the rdtsc ticks
+ * since the previous tick instead, so only cycles are measured.
+ */
+
+enum SelfProfileSubsystem {
+  SP_DISPATCH,      // ArchC decode and dispatch, behaviors, everything else
+  SP_DATA_CACHE,    // verifyCacheRead / verifyCacheWrite
+  SP_INSTRUCTION_CACHE,
+  SP_BRANCH,        // branchTaken / branchNotTaken
+  SP_HAZARD,        // verifyHazard
+  SP_SUBSYSTEMS
+};
+
+const char *selfProfileName[SP_SUBSYSTEMS] = {
+  "decode/dispatch", "verifyCacheRead/Write", "verifyInstructionCache", "branchTaken/NotTaken", "verifyHazard"
+};
+
+enum SelfProfileEvent {
+  SPE_CYCLES,
+  SPE_INSTRUCTIONS,
+  SPE_MISSES,
+  SPE_EVENTS
+};
+
+const char *selfProfileEventName[SPE_EVENTS] = { "cycles", "instructions", "cache misses" };
+
+volatile sig_atomic_t selfProfileState;
+
+// Counter totals and samples per subsystem, only written by the handlers
+volatile uint64_t selfProfileCount[SP_SUBSYSTEMS][SPE_EVENTS];
+volatile uint64_t selfProfileSamples[SP_SUBSYSTEMS];
+
+int selfProfileFd[SPE_EVENTS] = { -1, -1, -1 };
+uint64_t selfProfilePeriod[SPE_EVENTS] = {
+  SELF_PROFILE_CYCLES_PERIOD, SELF_PROFILE_INSTRUCTIONS_PERIOD, SELF_PROFILE_MISSES_PERIOD
+};
+bool selfProfilePerf;
+bool selfProfileRunning;
+volatile uint64_t selfProfileLastTick;
+struct timespec selfProfileStartTime;
+
+class SelfProfileScope {
+  sig_atomic_t saved;
+public:
+  SelfProfileScope (int subsystem) : saved(selfProfileState) { selfProfileState = subsystem; }
+  ~SelfProfileScope () { selfProfileState = saved; }
+};
+
+#ifdef SELF_PROFILE
+#define SELF_PROFILE_SCOPE(SUBSYSTEM) SelfProfileScope selfProfileScope(SUBSYSTEM)
+#else
+#define SELF_PROFILE_SCOPE(SUBSYSTEM)
+#endif
+
+inline uint64_t selfProfileTicks () {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+void selfProfileOverflow (int, siginfo_t *info, void *) {
+  int state = selfProfileState;
+  for (int e = 0; e < SPE_EVENTS; e++)
+    if (selfProfileFd[e] >= 0 && info->si_fd == selfProfileFd[e]) {
+      selfProfileCount[state][e] += selfProfilePeriod[e];
+      if (e == SPE_CYCLES)
+        selfProfileSamples[state]++;
+      ioctl(selfProfileFd[e], PERF_EVENT_IOC_REFRESH, 1);
+    }
+}
+
+void selfProfileTick (int) {
+  uint64_t now = selfProfileTicks();
+  selfProfileCount[selfProfileState][SPE_CYCLES] += now - selfProfileLastTick;
+  selfProfileSamples[selfProfileState]++;
+  selfProfileLastTick = now;
+}
+
+int selfProfileOpen (uint64_t config, uint64_t period) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.sample_period = period;
+  attr.wakeup_events = 1;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  if (fd < 0)
+    return -1;
+
+  // one signal per overflow, to this thread
+  struct f_owner_ex owner;
+  owner.type = F_OWNER_TID;
+  owner.pid = syscall(__NR_gettid);
+  if (fcntl(fd, F_SETFL, O_RDWR | O_NONBLOCK | O_ASYNC) != 0 || fcntl(fd, F_SETSIG, SELF_PROFILE_SIGNAL) != 0
+      || fcntl(fd, F_SETOWN_EX, &owner) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Once per process, whatever the number of cores
+void selfProfileStart () {
+  if (selfProfileRunning)
+    return;
+  selfProfileRunning = true;
+  memset((void *) selfProfileCount, 0, sizeof(selfProfileCount));
+  memset((void *) selfProfileSamples, 0, sizeof(selfProfileSamples));
+  selfProfileState = SP_DISPATCH;
+  clock_gettime(CLOCK_MONOTONIC, &selfProfileStartTime);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART | SA_SIGINFO;
+  sa.sa_sigaction = selfProfileOverflow;
+  sigaction(SELF_PROFILE_SIGNAL, &sa, NULL);
+
+  const uint64_t config[SPE_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES
+  };
+  for (int e = 0; e < SPE_EVENTS; e++)
+    selfProfileFd[e] = selfProfileOpen(config[e], selfProfilePeriod[e]);
+
+  selfProfilePerf = selfProfileFd[SPE_CYCLES] >= 0;
+  if (selfProfilePerf) {
+    for (int e = 0; e < SPE_EVENTS; e++)
+      if (selfProfileFd[e] >= 0) {
+        ioctl(selfProfileFd[e], PERF_EVENT_IOC_RESET, 0);
+        ioctl(selfProfileFd[e], PERF_EVENT_IOC_REFRESH, 1);
+      }
+    return;
+  }
+
+  fprintf(stderr, "selfprof: no hardware counters, sampling rdtsc with a %d Hz timer\n", SELF_PROFILE_HZ);
+  for (int e = 0; e < SPE_EVENTS; e++)
+    if (selfProfileFd[e] >= 0) {
+      close(selfProfileFd[e]);
+      selfProfileFd[e] = -1;
+    }
+  memset(&sa, 0, sizeof(sa));
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  sa.sa_handler = selfProfileTick;
+  sigaction(SIGPROF, &sa, NULL);
+
+  selfProfileLastTick = selfProfileTicks();
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = 1000000 / SELF_PROFILE_HZ;
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+void selfProfileStop () {
+  if (!selfProfileRunning)
+    return;
+  selfProfileRunning = false;
+  if (selfProfilePerf) {
+    for (int e = 0; e < SPE_EVENTS; e++)
+      if (selfProfileFd[e] >= 0)
+        ioctl(selfProfileFd[e], PERF_EVENT_IOC_DISABLE, 0);
+  } else {
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+  }
+  signal(SELF_PROFILE_SIGNAL, SIG_IGN);
+  signal(SIGPROF, SIG_IGN);
+}
+
+void selfProfileReport () {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  double seconds = (now.tv_sec - selfProfileStartTime.tv_sec) + (now.tv_nsec - selfProfileStartTime.tv_nsec) / 1e9;
+
+  printf("\n\n******************* SIMULATOR SELF-PROFILE **********************\n");
+  uint64_t total[SPE_EVENTS] = { 0, 0, 0 };
+  uint64_t samples = 0;
+  for (int s = 0; s < SP_SUBSYSTEMS; s++) {
+    for (int e = 0; e < SPE_EVENTS; e++)
+      total[e] += selfProfileCount[s][e];
+    samples += selfProfileSamples[s];
+  }
+
+  if (selfProfilePerf) {
+    printf("- perf_event_open, %.2lf s:", seconds);
+    for (int e = 0; e < SPE_EVENTS; e++) {
+      uint64_t count = 0;
+      if (selfProfileFd[e] < 0 || read(selfProfileFd[e], &count, sizeof(count)) != sizeof(count))
+        printf(" %s unavailable;", selfProfileEventName[e]);
+      else
+        printf(" %s %llu (a sample every %llu);", selfProfileEventName[e], (unsigned long long) count,
+               (unsigned long long) selfProfilePeriod[e]);
+    }
+    printf("\n");
+  } else {
+    printf("- rdtsc at %d Hz, %.2lf s, %llu samples (cycles only)\n", SELF_PROFILE_HZ, seconds,
+           (unsigned long long) samples);
+  }
+
+  printf("  %-24s %9s %8s %8s %6s %8s %8s\n", "subsystem", "samples", "cycles%", "instr%", "IPC",
+         "misses%", "MPKI");
+  for (int s = 0; s < SP_SUBSYSTEMS; s++) {
+    const volatile uint64_t *c = selfProfileCount[s];
+    printf("  %-24s %9llu %7.2lf%%", selfProfileName[s], (unsigned long long) selfProfileSamples[s],
+           total[SPE_CYCLES] ? 100.0 * c[SPE_CYCLES] / total[SPE_CYCLES] : 0.0);
+    if (selfProfilePerf)
+      printf(" %7.2lf%% %6.2lf %7.2lf%% %8.2lf",
+             total[SPE_INSTRUCTIONS] ? 100.0 * c[SPE_INSTRUCTIONS] / total[SPE_INSTRUCTIONS] : 0.0,
+             c[SPE_CYCLES] ? (double) c[SPE_INSTRUCTIONS] / c[SPE_CYCLES] : 0.0,
+             total[SPE_MISSES] ? 100.0 * c[SPE_MISSES] / total[SPE_MISSES] : 0.0,
+             c[SPE_INSTRUCTIONS] ? 1000.0 * c[SPE_MISSES] / c[SPE_INSTRUCTIONS] : 0.0);
+    printf("\n");
+  }
+  printf("*****************************************************************\n");
+
+  for (int e = 0; e < SPE_EVENTS; e++)
+    if (selfProfileFd[e] >= 0) {
+      close(selfProfileFd[e]);
+      selfProfileFd[e] = -1;
+    }
+}
+
+/*************************************************/
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef _MC723_SPM_H
+#define _MC723_SPM_H
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "mc723.h"
+#include "mc723_elf.h"
+
+/************** Scratchpad memory ****************/
+
+// Uncomment to map the objects in SPM_OBJECTS to an on-chip scratchpad:
+// their accesses have a fixed latency and bypass dataCache
+//#define SCRATCHPAD
+
+// Uncomment to rank the data objects by access density and data cache
+// misses and suggest what to place in a SPM_SIZE scratchpad
+//#define SPM_ANALYSIS
+
+// Scratchpad capacity in bytes
+#define SPM_SIZE 4096
+
+// Comma separated ELF data symbols; "stack" is the SPM_STACK_BYTES below
+// the initial stack pointer
+#define SPM_OBJECTS "stack"
+#define SPM_STACK_BYTES 2048
+
+// Cycles of a scratchpad access (a dataCache hit takes 1)
+#define SPM_ACCESS_CYCLES 1
+
+#define SPM_TOP_N 10
+
+#if (defined(SCRATCHPAD) || defined(SPM_ANALYSIS)) && defined(DECOUPLED_TIMING)
+#error "the scratchpad models read the stack pointer from the behaviors and cannot run with DECOUPLED_TIMING"
+#endif
+
+#if (defined(SCRATCHPAD) || defined(SPM_ANALYSIS)) && CORES > 1
+#error "the scratchpad models keep a single scratchpad and stack pointer and support one core"
+#endif
+
+/*
+ * The addresses are the effective ones (base + imm) that dataCache sees
+ * (see Type_I_MEMREAD), so the accesses moved to the scratchpad are exactly
+ * the ones removed from the cache numbers.
+ */
+
+typedef struct {
+  std::string name;
+  unsigned int start, end;   // [start, end)
+} SpmRange;
+
+typedef struct {
+  std::string name;
+  unsigned int size;
+  unsigned long long accesses;
+  unsigned long long misses;
+} SpmObject;
+
+std::vector<SpmRange> spmRanges;
+bool spmResolved;
+unsigned int spmUsed;
+unsigned long long spmAccesses;
+
+// Highest and lowest stack pointer seen by the loads and stores, and the
+// end of the highest word they addressed through sp
+unsigned int spmStackTop;
+unsigned int spmStackBottom;
+unsigned int spmStackEnd;
+
+// One entry per ELF symbol, then the stack and everything else
+std::vector<SpmObject> spmObjects;
+
+void spmInit () {
+  spmRanges.clear();
+  spmResolved = false;
+  spmUsed = 0;
+  spmAccesses = 0;
+  spmStackTop = 0;
+  spmStackBottom = 0xFFFFFFFF;
+  spmStackEnd = 0;
+  spmObjects.clear();
+}
+
+inline void spmStackPointer (unsigned int sp) {
+  if (sp > spmStackTop)
+    spmStackTop = sp;
+  if (sp < spmStackBottom)
+    spmStackBottom = sp;
+}
+
+// A load or store based on sp; the frames live above the stack pointer
+inline void spmStackAccess (unsigned int addr) {
+  if (addr + 4 > spmStackEnd)
+    spmStackEnd = (addr & ~3u) + 4;
+}
+
+bool spmAddRange (const std::string &name, unsigned int start, unsigned int size) {
+  if (spmUsed + size > SPM_SIZE) {
+    fprintf(stderr, "spm: '%s' (%u bytes) does not fit, %u of %d bytes used\n",
+            name.c_str(), size, spmUsed, SPM_SIZE);
+    return false;
+  }
+  SpmRange range;
+  range.name = name;
+  range.start = start;
+  range.end = start + size;
+  spmRanges.push_back(range);
+  spmUsed += size;
+  return true;
+}
+
+// Done at the first access, when the stack pointer is known
+void spmResolve () {
+  spmResolved = true;
+
+  std::string list = SPM_OBJECTS;
+  size_t pos = 0;
+  while (pos <= list.size()) {
+    size_t comma = list.find(',', pos);
+    if (comma == std::string::npos)
+      comma = list.size();
+    std::string name = list.substr(pos, comma - pos);
+    pos = comma + 1;
+    if (name.empty())
+      continue;
+
+    if (name == "stack") {
+      // the frames below the stack pointer of the first access
+      spmAddRange(name, spmStackTop - SPM_STACK_BYTES, SPM_STACK_BYTES);
+      continue;
+    }
+
+    const ElfSymbol *sym = findElfSymbolByName(name.c_str());
+    if (sym == NULL || sym->isFunction || sym->size == 0)
+      fprintf(stderr, "spm: no data object called '%s'\n", name.c_str());
+    else
+      spmAddRange(name, sym->addr, sym->size);
+  }
+}
+
+// Returns true when addr is served by the scratchpad
+inline bool spmAccess (unsigned int addr) {
+  if (!spmResolved)
+    spmResolve();
+  for (size_t r = 0; r < spmRanges.size(); r++)
+    if (addr >= spmRanges[r].start && addr < spmRanges[r].end) {
+      spmAccesses++;
+      return true;
+    }
+  return false;
+}
+
+// Attributes a dataCache access (and the misses it caused) to its object
+void spmProfile (unsigned int addr, int misses) {
+  if (spmObjects.empty()) {
+    loadElfSymbols();
+    spmObjects.resize(elfSymbols.size() + 2);
+    for (size_t i = 0; i < elfSymbols.size(); i++) {
+      spmObjects[i].name = elfSymbols[i].name;
+      spmObjects[i].size = elfSymbols[i].size;
+    }
+    spmObjects[elfSymbols.size()].name = "[stack]";
+    spmObjects[elfSymbols.size() + 1].name = "[other]";
+  }
+
+  size_t index = elfSymbols.size() + 1;
+  const ElfSymbol *sym = findElfSymbol(addr);
+  if (sym != NULL && !sym->isFunction && sym->size != 0)
+    index = sym - &elfSymbols[0];
+  else if (addr >= spmStackBottom && addr < spmStackEnd)
+    index = elfSymbols.size();
+
+  spmObjects[index].accesses++;
+  spmObjects[index].misses += misses;
+}
+
+bool spmMoreMisses (const SpmObject *a, const SpmObject *b) {
+  return a->misses > b->misses;
+}
+
+// Misses saved per scratchpad byte, the greedy order of the suggestion
+bool spmBetterValue (const SpmObject *a, const SpmObject *b) {
+  return (double) a->misses / a->size > (double) b->misses / b->size;
+}
+
+void spmReport (unsigned long long memAccesses, unsigned long long dataMisses) {
+  printf("\n\n*********************** SCRATCHPAD ******************************\n");
+
+#ifdef SCRATCHPAD
+  printf("- %u of %d bytes mapped:", spmUsed, SPM_SIZE);
+  for (size_t r = 0; r < spmRanges.size(); r++)
+    printf(" %s [%#x, %#x)", spmRanges[r].name.c_str(), spmRanges[r].start, spmRanges[r].end);
+  printf("\n");
+  printf("- scratchpad accesses: %llu (%.2lf%% of the memory accesses), %llu cycles\n", spmAccesses,
+         memAccesses ? 100.0 * spmAccesses / memAccesses : 0.0, spmAccesses * SPM_ACCESS_CYCLES);
+  printf("- data cache misses with the scratchpad: %llu\n", dataMisses);
+#endif
+
+#ifdef SPM_ANALYSIS
+  if (!spmObjects.empty())
+    spmObjects[spmObjects.size() - 2].size = spmStackEnd > spmStackBottom ? spmStackEnd - spmStackBottom : 0;
+
+  std::vector<const SpmObject *> ranked;
+  unsigned long long totalMisses = 0;
+  for (size_t i = 0; i < spmObjects.size(); i++) {
+    if (spmObjects[i].accesses == 0)
+      continue;
+    totalMisses += spmObjects[i].misses;
+    ranked.push_back(&spmObjects[i]);
+  }
+  std::sort(ranked.begin(), ranked.end(), spmMoreMisses);
+
+  printf("- data objects by data cache misses:\n");
+  printf("  %-24s %10s %12s %12s %12s %8s\n", "object", "bytes", "accesses", "acc/byte", "misses", "misses%");
+  for (size_t i = 0; i < ranked.size() && i < SPM_TOP_N; i++) {
+    const SpmObject &o = *ranked[i];
+    printf("  %-24.24s %10u %12llu %12.2lf %12llu %7.2lf%%\n", o.name.c_str(), o.size, o.accesses,
+           o.size ? (double) o.accesses / o.size : 0.0, o.misses,
+           totalMisses ? 100.0 * o.misses / totalMisses : 0.0);
+  }
+
+  // greedy knapsack on misses saved per byte; "[other]" has no size
+  std::vector<const SpmObject *> candidates;
+  for (size_t i = 0; i < ranked.size(); i++)
+    if (ranked[i]->size > 0 && ranked[i]->misses > 0 && ranked[i] != &spmObjects.back())
+      candidates.push_back(ranked[i]);
+  std::sort(candidates.begin(), candidates.end(), spmBetterValue);
+
+  unsigned int used = 0;
+  unsigned long long saved = 0, moved = 0;
+  printf("- suggested allocation of a %d byte scratchpad:", SPM_SIZE);
+  for (size_t i = 0; i < candidates.size(); i++) {
+    if (used + candidates[i]->size > SPM_SIZE)
+      continue;
+    used += candidates[i]->size;
+    saved += candidates[i]->misses;
+    moved += candidates[i]->accesses;
+    printf(" %s", candidates[i]->name.c_str());
+  }
+  printf("\n  %u bytes, %llu accesses moved, %llu data cache misses saved (%.2lf%%)\n", used, moved, saved,
+         totalMisses ? 100.0 * saved / totalMisses : 0.0);
+#endif
+
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
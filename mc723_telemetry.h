@@ -0,0 +1,149 @@
+#ifndef _MC723_TELEMETRY_H
+#define _MC723_TELEMETRY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/************** Live telemetry ****************/
+
+// Uncomment to publish the counters in the shared memory segment
+// /dev/shm/mc723-<pid> every TELEMETRY_INTERVAL instructions; watch them
+// with ./mc723top (make mc723top)
+//#define TELEMETRY
+
+#define TELEMETRY_INTERVAL (1 << 20)
+
+#if defined(TELEMETRY) && defined(DECOUPLED_TIMING)
+#error "TELEMETRY reads the counters from the functional thread while the timing threads write them and cannot run with DECOUPLED_TIMING"
+#endif
+
+#define TELEMETRY_MAGIC 0x4D433732   // "MC72"
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_PREFIX "/mc723-"
+
+/*
+ * Layout shared with the reader. The writer makes seq odd while it updates
+ * the counters and even again after, so a reader retries when it sees an
+ * odd seq or a different seq before and after its copy. Fields are only
+ * ever appended; anything else bumps TELEMETRY_VERSION.
+ */
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  volatile uint32_t seq;
+  uint32_t pid;
+  uint32_t finished;
+  uint32_t interval;
+  char program[128];
+
+  uint64_t hostStartNs;       // CLOCK_MONOTONIC
+  uint64_t hostNs;            // at the last update
+  uint64_t instructions;
+  uint64_t memAccesses;
+  uint64_t dataMisses;
+  uint64_t instructionMisses;
+  uint64_t branches;
+  uint64_t mispredicts;       // two-bits predictor
+  uint64_t hazards;
+} TelemetryPage;
+
+inline uint64_t telemetryNow () {
+  struct timespec ts;
+  // vDSO on Linux, no system call
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Copies a consistent snapshot of page, returns false if it never settles
+bool telemetryRead (const TelemetryPage *page, TelemetryPage &copy) {
+  for (int attempt = 0; attempt < 1000; attempt++) {
+    uint32_t before = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+    if (before & 1)
+      continue;
+    memcpy(&copy, (const void *) page, sizeof(copy));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&page->seq, __ATOMIC_RELAXED) == before)
+      return true;
+  }
+  return false;
+}
+
+#ifdef TELEMETRY
+
+TelemetryPage *telemetryPage;
+char telemetryName[64];
+
+void telemetryInit (const char *program) {
+  if (telemetryPage != NULL)
+    return;
+
+  snprintf(telemetryName, sizeof(telemetryName), TELEMETRY_PREFIX "%d", (int) getpid());
+  int fd = shm_open(telemetryName, O_CREAT | O_RDWR | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate(fd, sizeof(TelemetryPage)) != 0) {
+    fprintf(stderr, "telemetry: could not create %s\n", telemetryName);
+    if (fd >= 0)
+      close(fd);
+    return;
+  }
+
+  void *map = mmap(NULL, sizeof(TelemetryPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "telemetry: could not map %s\n", telemetryName);
+    return;
+  }
+
+  telemetryPage = (TelemetryPage *) map;
+  memset(telemetryPage, 0, sizeof(TelemetryPage));
+  telemetryPage->pid = getpid();
+  telemetryPage->interval = TELEMETRY_INTERVAL;
+  strncpy(telemetryPage->program, program, sizeof(telemetryPage->program) - 1);
+  telemetryPage->hostStartNs = telemetryPage->hostNs = telemetryNow();
+  telemetryPage->version = TELEMETRY_VERSION;
+  __atomic_store_n(&telemetryPage->magic, TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+}
+
+// Only called every TELEMETRY_INTERVAL instructions and at the end
+void telemetryPublish (uint64_t instructions, uint64_t memAccesses, uint64_t dataMisses,
+                       uint64_t instructionMisses, uint64_t branches, uint64_t mispredicts,
+                       uint64_t hazards, bool finished) {
+  TelemetryPage *p = telemetryPage;
+  if (p == NULL)
+    return;
+
+  uint32_t seq = p->seq;
+  __atomic_store_n(&p->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  p->hostNs = telemetryNow();
+  p->instructions = instructions;
+  p->memAccesses = memAccesses;
+  p->dataMisses = dataMisses;
+  p->instructionMisses = instructionMisses;
+  p->branches = branches;
+  p->mispredicts = mispredicts;
+  p->hazards = hazards;
+  p->finished = finished;
+
+  __atomic_store_n(&p->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// The segment is not unlinked, so a reader started late still sees the
+// final counters; mc723top --clean removes the ones of exited simulators
+void telemetryFinish () {
+  if (telemetryPage == NULL)
+    return;
+  munmap(telemetryPage, sizeof(TelemetryPage));
+  telemetryPage = NULL;
+}
+
+#endif
+
+/*************************************************/
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef _MC723_THREEC_H
+#define _MC723_THREEC_H
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "mc723.h"
+#include "mc723_coherence.h"
+
+/************** Three-C miss classification ****************/
+
+// Uncomment to split the misses of every cache into compulsory, capacity
+// and conflict misses
+//#define THREE_C_MISSES
+
+/*
+ * A miss is compulsory when the line was never touched before (first-touch
+ * bitmap), a capacity miss when a fully associative LRU cache with the same
+ * number of lines would also miss, and a conflict miss otherwise. The
+ * shadow cache is a hash table plus an intrusive LRU list over a fixed
+ * pool of nodes, so every access is O(1).
+ */
+
+// The first-touch bitmap covers the whole 32-bit line address space but is
+// allocated in chunks of 2^THREE_C_CHUNK_BITS lines, only where touched
+#define THREE_C_CHUNK_BITS 16
+
+#define THREE_C_NONE -1
+
+typedef struct {
+  unsigned int line;
+  int prev, next;   // LRU list, head is the most recently used
+  int hashNext;     // bucket chain
+} ThreeCNode;
+
+typedef struct {
+  const char *name;
+  unsigned int lineBits;
+
+  // shadow fully associative LRU cache
+  std::vector<ThreeCNode> nodes;
+  std::vector<int> buckets;
+  unsigned int bucketMask;
+  int head, tail;
+  int used;
+
+  // first-touch bitmap
+  std::vector<unsigned int *> touched;
+
+  unsigned long long accesses;
+  unsigned long long compulsory;
+  unsigned long long capacity;
+  unsigned long long conflict;
+  unsigned long long writebacks;
+} ThreeCModel;
+
+ThreeCModel dataThreeC[CORES];
+ThreeCModel instructionThreeC[CORES];
+
+void threeCInit (ThreeCModel &m, const char *name, unsigned int lines, unsigned int lineBits) {
+  m.name = name;
+  m.lineBits = lineBits;
+
+  m.nodes.assign(lines, ThreeCNode());
+  unsigned int buckets = 1;
+  while (buckets < 2 * lines)
+    buckets <<= 1;
+  m.buckets.assign(buckets, THREE_C_NONE);
+  m.bucketMask = buckets - 1;
+  m.head = m.tail = THREE_C_NONE;
+  m.used = 0;
+
+  for (size_t i = 0; i < m.touched.size(); i++)
+    delete [] m.touched[i];
+  m.touched.assign(1u << (32 - lineBits - THREE_C_CHUNK_BITS), (unsigned int *) NULL);
+
+  m.accesses = m.compulsory = m.capacity = m.conflict = m.writebacks = 0;
+}
+
+// Marks the line as touched and returns whether it already was
+bool threeCTouch (ThreeCModel &m, unsigned int line) {
+  unsigned int *&chunk = m.touched[line >> THREE_C_CHUNK_BITS];
+  if (chunk == NULL) {
+    chunk = new unsigned int[(1 << THREE_C_CHUNK_BITS) / 32];
+    memset(chunk, 0, (1 << THREE_C_CHUNK_BITS) / 8);
+  }
+
+  unsigned int bit = line & ((1 << THREE_C_CHUNK_BITS) - 1);
+  unsigned int mask = 1u << (bit & 31);
+  bool seen = (chunk[bit >> 5] & mask) != 0;
+  chunk[bit >> 5] |= mask;
+  return seen;
+}
+
+unsigned int threeCBucket (const ThreeCModel &m, unsigned int line) {
+  return (line * 2654435761u) & m.bucketMask;
+}
+
+void threeCUnlink (ThreeCModel &m, int n) {
+  ThreeCNode &node = m.nodes[n];
+  if (node.prev != THREE_C_NONE) m.nodes[node.prev].next = node.next; else m.head = node.next;
+  if (node.next != THREE_C_NONE) m.nodes[node.next].prev = node.prev; else m.tail = node.prev;
+}
+
+void threeCPushFront (ThreeCModel &m, int n) {
+  m.nodes[n].prev = THREE_C_NONE;
+  m.nodes[n].next = m.head;
+  if (m.head != THREE_C_NONE)
+    m.nodes[m.head].prev = n;
+  m.head = n;
+  if (m.tail == THREE_C_NONE)
+    m.tail = n;
+}
+
+// Accesses the shadow cache and returns whether the line was there
+bool threeCShadow (ThreeCModel &m, unsigned int line) {
+  int &bucket = m.buckets[threeCBucket(m, line)];
+  for (int n = bucket; n != THREE_C_NONE; n = m.nodes[n].hashNext) {
+    if (m.nodes[n].line == line) {
+      if (n != m.head) {
+        threeCUnlink(m, n);
+        threeCPushFront(m, n);
+      }
+      return true;
+    }
+  }
+
+  int n;
+  if (m.used < (int) m.nodes.size()) {
+    n = m.used++;
+  } else {
+    // evict the LRU line from its bucket chain and reuse its node
+    n = m.tail;
+    threeCUnlink(m, n);
+    int *link = &m.buckets[threeCBucket(m, m.nodes[n].line)];
+    while (*link != n)
+      link = &m.nodes[*link].hashNext;
+    *link = m.nodes[n].hashNext;
+  }
+
+  m.nodes[n].line = line;
+  m.nodes[n].hashNext = bucket;
+  bucket = n;
+  threeCPushFront(m, n);
+  return false;
+}
+
+/*
+ * Called once per access to the real cache with the number of misses it
+ * counted for it (2 when a dirty line had to be written back first).
+ */
+void threeCAccess (ThreeCModel &m, unsigned int line, int misses) {
+  bool inShadow = threeCShadow(m, line);
+  bool seen = threeCTouch(m, line);
+  m.accesses++;
+
+  if (misses == 0)
+    return;
+
+  if (!seen)
+    m.compulsory++;
+  else if (!inShadow)
+    m.capacity++;
+  else
+    m.conflict++;
+  m.writebacks += misses - 1;
+}
+
+void threeCPrint (const ThreeCModel &m) {
+  unsigned long long misses = m.compulsory + m.capacity + m.conflict;
+  double total = misses ? (double) misses : 1.0;
+  printf("- %s (%u lines of %u bytes): %llu accesses, %llu misses\n", m.name,
+         (unsigned int) m.nodes.size(), 1u << m.lineBits, m.accesses, misses);
+  printf("  compulsory: %llu (%.2lf%%)\n", m.compulsory, 100.0 * m.compulsory / total);
+  printf("  capacity:   %llu (%.2lf%%)\n", m.capacity, 100.0 * m.capacity / total);
+  printf("  conflict:   %llu (%.2lf%%)\n", m.conflict, 100.0 * m.conflict / total);
+  if (m.writebacks)
+    printf("  + dirty writebacks counted as misses: %llu\n", m.writebacks);
+}
+
+void threeCReport () {
+  printf("\n\n*********************** 3C MISSES *******************************\n");
+  for (int c = 0; c < CORES; c++) {
+    if (dataThreeC[c].name == NULL)
+      continue;
+    if (CORES > 1)
+      printf("core %d:\n", c);
+    threeCPrint(dataThreeC[c]);
+    threeCPrint(instructionThreeC[c]);
+  }
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
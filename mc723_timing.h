@@ -0,0 +1,209 @@
+#ifndef _MC723_TIMING_H
+#define _MC723_TIMING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "mc723.h"
+
+/************** Decoupled functional / timing simulation ****************/
+
+// DECOUPLED_TIMING itself is defined in mc723.h, because currentPC must
+// become thread local with it.
+//
+// The behaviors only execute the instructions and describe each one in a
+// TimingEvent; the hazard, cache and branch prediction models run on
+// other threads fed through lock-free single-producer/single-consumer
+// rings. The model functions keep their signatures: on the simulation
+// thread they just fill the event, on a timing thread they do the work.
+
+// 1: every model on one timing thread
+// 2: hazard and caches on one thread, branch predictors on another
+#define TIMING_THREADS 1
+
+// log2 of the number of events in each ring
+#define TIMING_RING_BITS 16
+#define TIMING_RING_SIZE (1 << TIMING_RING_BITS)
+
+// The producer publishes its tail (and the consumer its head) once every
+// TIMING_BATCH events, so the shared cache lines bounce rarely
+#define TIMING_BATCH 64
+
+// Spins before an empty (or full) ring makes the thread yield the CPU
+#define TIMING_SPINS 1024
+
+#if defined(DECOUPLED_TIMING) && defined(CALLGRAPH_PROFILER)
+#error "CALLGRAPH_PROFILER follows the functional thread and cannot run with DECOUPLED_TIMING"
+#endif
+#if defined(DECOUPLED_TIMING) && defined(HOTSPOT_PROFILER) && TIMING_THREADS > 1
+#error "HOTSPOT_PROFILER needs all the models on a single timing thread"
+#endif
+
+#ifdef DECOUPLED_TIMING
+
+enum TimingFlags {
+  TE_CONTEXT   = 1,   // createContext was called
+  TE_HAZARD    = 2,   // verifyHazard was called
+  TE_LOAD      = 4,
+  TE_STORE     = 8,
+  TE_TAKEN     = 16,
+  TE_NOT_TAKEN = 32,
+  TE_HILO      = 64,  // mixHiLo(func) was called
+  TE_STOP      = 128  // no more events, the consumer exits
+};
+
+typedef struct {
+  unsigned int pc;
+  unsigned int fetchAddr;
+  unsigned int memAddr;
+  unsigned int branchTarget;
+  signed char r_dest, r_read1, r_read2;
+  unsigned char memSize;
+  unsigned char func;
+  unsigned char type;
+  unsigned char flags;
+} TimingEvent;
+
+#define TIMING_CACHE_LINE 64
+
+#if defined(__i386__) || defined(__x86_64__)
+#define TIMING_PAUSE() __builtin_ia32_pause()
+#else
+#define TIMING_PAUSE()
+#endif
+
+// head is written by the consumer, tail by the producer; each side keeps a
+// private copy of the other index and only reloads it when it looks stuck
+typedef struct {
+  volatile unsigned int head;
+  char pad0[TIMING_CACHE_LINE - sizeof(unsigned int)];
+  volatile unsigned int tail;
+  char pad1[TIMING_CACHE_LINE - sizeof(unsigned int)];
+  unsigned int producerTail;
+  unsigned int producerHead;
+  char pad2[TIMING_CACHE_LINE - 2 * sizeof(unsigned int)];
+  unsigned int consumerHead;
+  unsigned int consumerTail;
+  char pad3[TIMING_CACHE_LINE - 2 * sizeof(unsigned int)];
+  TimingEvent slots[TIMING_RING_SIZE];
+} TimingRing;
+
+TimingRing timingRing[TIMING_THREADS] __attribute__((aligned(TIMING_CACHE_LINE)));
+pthread_t timingThreads[TIMING_THREADS];
+
+// -1 on the simulation thread, the model thread number otherwise
+__thread int timingThread = -1;
+
+// Event being described by the behaviors of the current instruction
+TimingEvent timingEvent;
+bool timingEventStarted;
+
+// Implemented next to the models in mips1_isa.cpp
+void timingReplay (int thread, const TimingEvent &e);
+
+void timingBackoff (int &spins) {
+  if (++spins >= TIMING_SPINS) {
+    sched_yield();
+    spins = 0;
+  } else {
+    TIMING_PAUSE();
+  }
+}
+
+void timingPush (TimingRing &ring, const TimingEvent &e) {
+  unsigned int tail = ring.producerTail;
+  int spins = 0;
+
+  while (tail - ring.producerHead == TIMING_RING_SIZE) {
+    ring.producerHead = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE);
+    if (tail - ring.producerHead == TIMING_RING_SIZE)
+      timingBackoff(spins);
+  }
+
+  ring.slots[tail & (TIMING_RING_SIZE - 1)] = e;
+  ring.producerTail = ++tail;
+  if ((tail & (TIMING_BATCH - 1)) == 0 || (e.flags & TE_STOP))
+    __atomic_store_n(&ring.tail, tail, __ATOMIC_RELEASE);
+}
+
+void *timingConsumer (void *arg) {
+  timingThread = (int) (long) arg;
+  TimingRing &ring = timingRing[timingThread];
+  unsigned int head = ring.consumerHead;
+  int spins = 0;
+
+  for (;;) {
+    if (head == ring.consumerTail) {
+      ring.consumerTail = __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE);
+      if (head == ring.consumerTail) {
+        // let the producer reuse what was consumed before waiting
+        __atomic_store_n(&ring.head, head, __ATOMIC_RELEASE);
+        timingBackoff(spins);
+        continue;
+      }
+    }
+    spins = 0;
+
+    const TimingEvent &e = ring.slots[head & (TIMING_RING_SIZE - 1)];
+    if (e.flags & TE_STOP)
+      break;
+    timingReplay(timingThread, e);
+
+    if ((++head & (TIMING_BATCH - 1)) == 0)
+      __atomic_store_n(&ring.head, head, __ATOMIC_RELEASE);
+  }
+
+  __atomic_store_n(&ring.head, head, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+void timingPublish () {
+  if (!timingEventStarted)
+    return;
+  for (int t = 0; t < TIMING_THREADS; t++)
+    timingPush(timingRing[t], timingEvent);
+}
+
+// Starts the event of a new instruction, sending the previous one
+void timingBegin (unsigned int pc, unsigned int fetchAddr) {
+  timingPublish();
+  timingEvent.pc = pc;
+  timingEvent.fetchAddr = fetchAddr;
+  timingEvent.flags = 0;
+  timingEventStarted = true;
+}
+
+void timingStart () {
+  timingEventStarted = false;
+  for (int t = 0; t < TIMING_THREADS; t++) {
+    TimingRing &ring = timingRing[t];
+    ring.head = ring.tail = 0;
+    ring.producerHead = ring.producerTail = 0;
+    ring.consumerHead = ring.consumerTail = 0;
+
+    if (pthread_create(&timingThreads[t], NULL, timingConsumer, (void *) (long) t) != 0) {
+      fprintf(stderr, "timing: could not start the model threads\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+// Drains the rings; the model counters can only be read after this
+void timingStop () {
+  timingPublish();
+  timingEventStarted = false;
+
+  TimingEvent stop;
+  stop.flags = TE_STOP;
+  for (int t = 0; t < TIMING_THREADS; t++) {
+    timingPush(timingRing[t], stop);
+    pthread_join(timingThreads[t], NULL);
+  }
+}
+
+#endif
+
+/*************************************************/
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef _MC723_WAYPRED_H
+#define _MC723_WAYPRED_H
+
+#include <stdio.h>
+#include <string.h>
+#include "mc723.h"
+#include "mc723_assoc.h"
+#include "mc723_energy.h"
+
+/************** Way prediction / phased access ****************/
+
+// Uncomment to run a set-associative L1 with the capacity and line size of
+// dataCache next to it and compare its access schemes
+//#define WAY_PREDICTION
+
+/*
+ * Every data access goes to a WAYPRED_WAYS-way LRU cache and is costed
+ * under four schemes:
+ *  - parallel: all tags and all data ways read at once (fast, hungry)
+ *  - phased:   all tags first, then only the hit data way; one extra
+ *              cycle on every access
+ *  - MRU:      only the most recently used way of the set is probed first
+ *  - PC:       the way last hit by the same load/store PC is probed first
+ * A wrong way prediction probes the remaining ways in the next cycle.
+ * Array energies come from the ENERGY_MODEL SRAM costs.
+ */
+
+#define WAYPRED_WAYS 4
+// log2 of the PC-indexed way table entries
+#define WAYPRED_PC_BITS 10
+#define WAYPRED_PC_INDEX(PC) (((PC) >> 2) & ((1 << WAYPRED_PC_BITS) - 1))
+
+enum WayScheme {
+  WS_PARALLEL,
+  WS_PHASED,
+  WS_MRU,
+  WS_PC,
+  WS_SCHEMES
+};
+
+const char *wayPredSchemeName[WS_SCHEMES] = {
+  "parallel",
+  "phased",
+  "MRU way prediction",
+  "PC way prediction"
+};
+
+typedef struct {
+  unsigned long long correct;       // hits found in the predicted way
+  unsigned long long extraCycles;   // cycles over a direct-mapped access
+  double energy;                    // pJ
+} WaySchemeStats;
+
+typedef struct {
+  AssocCache cache;
+  std::vector<unsigned char> mru;   // per set
+  unsigned char pcWay[1 << WAYPRED_PC_BITS];
+  unsigned long long hits;
+  WaySchemeStats scheme[WS_SCHEMES];
+} WayPredModel;
+
+WayPredModel wayPred[CORES];
+
+void wayPredInit (WayPredModel &m) {
+  assocInit(m.cache, DATA_CACHE_SIZE, WAYPRED_WAYS, DATA_BLOCK_OFFSET_SIZE_BITS);
+  m.mru.assign(m.cache.sets, 0);
+  memset(m.pcWay, 0, sizeof(m.pcWay));
+  m.hits = 0;
+  memset(m.scheme, 0, sizeof(m.scheme));
+}
+
+// Costs of a probe that reads n tag ways and n data ways
+double wayPredTags (const WayPredModel &m, unsigned int n) {
+  unsigned int tagBits = energyTagBits(m.cache.setBits, m.cache.lineBits);
+  return n * energyArray(m.cache.sets, tagBits, tagBits, false);
+}
+
+double wayPredData (const WayPredModel &m, unsigned int n, bool write) {
+  unsigned int lineBits = 8 << m.cache.lineBits;
+  return n * energyArray(m.cache.sets, lineBits, ENERGY_WORD_BITS, write);
+}
+
+// Predicted way probed first, the others on a wrong prediction
+void wayPredProbe (WayPredModel &m, WaySchemeStats &s, int predicted, int way, bool hit, bool write) {
+  unsigned int ways = m.cache.ways;
+  s.energy += wayPredTags(m, 1) + (write ? 0 : wayPredData(m, 1, false));
+  if (hit && predicted == way) {
+    s.correct++;
+  } else {
+    s.energy += wayPredTags(m, ways - 1) + (write ? 0 : wayPredData(m, ways - 1, false));
+    if (hit)
+      s.extraCycles++;
+  }
+  if (write)
+    s.energy += wayPredData(m, 1, true);
+}
+
+void wayPredAccess (WayPredModel &m, unsigned int addr, unsigned int pc, bool write) {
+  unsigned int set = assocSet(m.cache, addr);
+  int mruWay = m.mru[set];
+  int pcWay = m.pcWay[WAYPRED_PC_INDEX(pc)];
+
+  bool hit;
+  int way = assocAccess(m.cache, addr, write, hit);
+  unsigned int ways = m.cache.ways;
+  if (hit)
+    m.hits++;
+
+  // stores always check the tags before writing a single way
+  WaySchemeStats &parallel = m.scheme[WS_PARALLEL];
+  parallel.energy += wayPredTags(m, ways) + (write ? wayPredData(m, 1, true) : wayPredData(m, ways, false));
+  if (hit)
+    parallel.correct++;
+
+  WaySchemeStats &phased = m.scheme[WS_PHASED];
+  phased.energy += wayPredTags(m, ways) + wayPredData(m, hit || write ? 1 : 0, write);
+  if (hit) {
+    phased.correct++;
+    if (!write)
+      phased.extraCycles++;
+  }
+
+  wayPredProbe(m, m.scheme[WS_MRU], mruWay, way, hit, write);
+  wayPredProbe(m, m.scheme[WS_PC], pcWay, way, hit, write);
+
+  m.mru[set] = way;
+  m.pcWay[WAYPRED_PC_INDEX(pc)] = way;
+}
+
+void wayPredReport (unsigned long long directMappedMisses) {
+  printf("\n\n******************** WAY PREDICTION ****************************\n");
+  for (int c = 0; c < CORES; c++) {
+    const WayPredModel &m = wayPred[c];
+    if (m.cache.accesses == 0)
+      continue;
+    if (CORES > 1)
+      printf("core %d:\n", c);
+
+    // dataCacheMiss also counts the writebacks of dirty lines
+    printf("- %u-way, %u sets of %u bytes: %llu accesses, %llu misses (%.2lf%%), %llu writebacks\n",
+           m.cache.ways, m.cache.sets, 1u << m.cache.lineBits, m.cache.accesses, m.cache.misses,
+           100.0 * m.cache.misses / m.cache.accesses, m.cache.writebacks);
+    printf("  misses + writebacks: %llu, direct-mapped dataCache: %llu\n",
+           m.cache.misses + m.cache.writebacks, directMappedMisses);
+
+    double base = m.scheme[WS_PARALLEL].energy;
+    printf("  %-20s %10s %14s %14s %10s\n", "scheme", "way acc.", "extra cycles", "energy (nJ)", "saved");
+    for (int s = 0; s < WS_SCHEMES; s++) {
+      const WaySchemeStats &st = m.scheme[s];
+      printf("  %-20s %9.2lf%% %14llu %14.3lf %9.2lf%%\n", wayPredSchemeName[s],
+             m.hits ? 100.0 * st.correct / m.hits : 0.0, st.extraCycles, st.energy / 1e3,
+             base > 0 ? 100.0 * (base - st.energy) / base : 0.0);
+    }
+  }
+  printf("*****************************************************************\n");
+}
+
+/*************************************************/
+
+#endif
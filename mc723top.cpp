@@ -0,0 +1,153 @@
+// Shows the live counters of the mips1.x simulators built with TELEMETRY
+// (see mc723_telemetry.h).
+//
+//   ./mc723top              every simulator with a segment in /dev/shm
+//   ./mc723top 1234 5678    only these pids
+//   ./mc723top -i 5 --once  one 5 second sample
+//   ./mc723top --clean      remove the segments of exited simulators
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <string>
+#include <vector>
+#include "mc723_telemetry.h"
+
+typedef struct {
+  std::string name;
+  const TelemetryPage *page;
+  TelemetryPage last;
+  bool seen;
+} Segment;
+
+bool alive (uint32_t pid) {
+  return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+const TelemetryPage *attach (const std::string &name) {
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return NULL;
+  void *map = mmap(NULL, sizeof(TelemetryPage), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return NULL;
+
+  const TelemetryPage *page = (const TelemetryPage *) map;
+  if (__atomic_load_n(&page->magic, __ATOMIC_ACQUIRE) != TELEMETRY_MAGIC
+      || page->version != TELEMETRY_VERSION) {
+    fprintf(stderr, "mc723top: %s has an unknown layout\n", name.c_str());
+    munmap(map, sizeof(TelemetryPage));
+    return NULL;
+  }
+  return page;
+}
+
+std::vector<std::string> findSegments () {
+  std::vector<std::string> names;
+  DIR *dir = opendir("/dev/shm");
+  if (dir == NULL)
+    return names;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL)
+    if (strncmp(entry->d_name, TELEMETRY_PREFIX + 1, strlen(TELEMETRY_PREFIX) - 1) == 0)
+      names.push_back(std::string("/") + entry->d_name);
+  closedir(dir);
+  return names;
+}
+
+double ratio (uint64_t a, uint64_t b) {
+  return b ? (double) a / b : 0.0;
+}
+
+int main (int argc, char **argv) {
+  double interval = 1.0;
+  bool once = false, clean = false;
+  std::vector<std::string> names;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+      interval = atof(argv[++i]);
+    else if (strcmp(argv[i], "--once") == 0)
+      once = true;
+    else if (strcmp(argv[i], "--clean") == 0)
+      clean = true;
+    else if (argv[i][0] >= '0' && argv[i][0] <= '9')
+      names.push_back(std::string(TELEMETRY_PREFIX) + argv[i]);
+    else {
+      fprintf(stderr, "usage: %s [-i seconds] [--once] [--clean] [pid...]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (names.empty())
+    names = findSegments();
+
+  std::vector<Segment> segments;
+  for (size_t i = 0; i < names.size(); i++) {
+    const TelemetryPage *page = attach(names[i]);
+    if (page == NULL)
+      continue;
+    if (clean) {
+      if (!alive(page->pid)) {
+        shm_unlink(names[i].c_str());
+        printf("removed %s\n", names[i].c_str());
+      }
+      continue;
+    }
+    Segment s;
+    s.name = names[i];
+    s.page = page;
+    s.seen = telemetryRead(page, s.last);
+    segments.push_back(s);
+  }
+  if (clean)
+    return 0;
+  if (segments.empty()) {
+    fprintf(stderr, "mc723top: no simulator found\n");
+    return 1;
+  }
+
+  for (;;) {
+    usleep((useconds_t) (interval * 1e6));
+
+    printf("%7s %-20s %14s %8s %8s %8s %8s %8s %8s %9s\n", "pid", "program", "instructions", "MIPS",
+           "avg MIPS", "dmiss%", "imiss%", "mispr%", "hazard%", "state");
+    bool running = false;
+    for (size_t i = 0; i < segments.size(); i++) {
+      Segment &s = segments[i];
+      TelemetryPage now;
+      if (!telemetryRead(s.page, now))
+        continue;
+
+      // rates over the last interval, averages since the start
+      uint64_t instructions = now.instructions - s.last.instructions;
+      double seconds = (now.hostNs - s.last.hostNs) / 1e9;
+      double total = (now.hostNs - now.hostStartNs) / 1e9;
+      const char *program = strrchr(now.program, '/') ? strrchr(now.program, '/') + 1 : now.program;
+      const char *state = now.finished ? "finished" : alive(now.pid) ? "running" : "killed";
+
+      printf("%7u %-20.20s %14llu %8.2lf %8.2lf %7.2lf%% %7.2lf%% %7.2lf%% %7.2lf%% %9s\n", now.pid,
+             program, (unsigned long long) now.instructions,
+             seconds > 0 ? instructions / seconds / 1e6 : 0.0,
+             total > 0 ? now.instructions / total / 1e6 : 0.0,
+             100 * ratio(now.dataMisses - s.last.dataMisses, now.memAccesses - s.last.memAccesses),
+             100 * ratio(now.instructionMisses - s.last.instructionMisses, instructions),
+             100 * ratio(now.mispredicts - s.last.mispredicts, now.branches - s.last.branches),
+             100 * ratio(now.hazards - s.last.hazards, instructions), state);
+
+      // keep the previous sample until a new one is published
+      if (now.seq != s.last.seq)
+        s.last = now;
+      if (!now.finished && alive(now.pid))
+        running = true;
+    }
+    printf("\n");
+    fflush(stdout);
+
+    if (once || !running)
+      return 0;
+  }
+}
@@ -0,0 +1,30 @@
+/*
+ * Branchy loop microkernel: data dependent branches driven by a linear
+ * congruential generator (unpredictable) mixed with short periodic
+ * patterns (learnable by a two-bit predictor).
+ */
+#include <stdio.h>
+
+#define ITERATIONS (1 << 22)
+
+int main (void) {
+  unsigned int x = 723;
+  int i;
+  int a = 0, b = 0, c = 0;
+
+  for (i = 0; i < ITERATIONS; i++) {
+    x = x * 1103515245u + 12345u;
+
+    if (x & 0x10000)
+      a++;
+    if ((i & 3) == 0)
+      b++;
+    if ((i & 7) < 6)
+      c += a;
+    else
+      c -= b;
+  }
+
+  printf("branchy %d %d %d\n", a, b, c);
+  return 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * Pointer chase microkernel: every load depends on the previous one and
+ * the nodes are visited in a random cyclic order, so each access touches
+ * a new cache line once the footprint exceeds the data cache.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NODES (1 << 16)
+#define STEPS (1 << 22)
+
+struct node {
+  struct node *next;
+  int pad[3];   /* one node per 16-byte cache line */
+};
+
+static struct node nodes[NODES];
+static int order[NODES];
+
+int main (void) {
+  int i;
+  struct node *p;
+
+  for (i = 0; i < NODES; i++)
+    order[i] = i;
+
+  /* Sattolo's shuffle gives a single cycle through all nodes */
+  srand(723);
+  for (i = NODES - 1; i > 0; i--) {
+    int j = rand() % i;
+    int t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+  for (i = 0; i < NODES; i++)
+    nodes[order[i]].next = &nodes[order[(i + 1) % NODES]];
+
+  p = &nodes[0];
+  for (i = 0; i < STEPS; i++)
+    p = p->next;
+
+  printf("pointer_chase %d\n", (int) (p - nodes));
+  return 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * Streaming copy microkernel: sequential loads and stores over two arrays
+ * much larger than the data cache, one miss per line on each stream.
+ */
+#include <stdio.h>
+
+#define WORDS (1 << 18)
+#define PASSES 16
+
+static int src[WORDS];
+static int dst[WORDS];
+
+int main (void) {
+  int i, pass;
+  int sum = 0;
+
+  for (i = 0; i < WORDS; i++)
+    src[i] = i;
+
+  for (pass = 0; pass < PASSES; pass++)
+    for (i = 0; i < WORDS; i++)
+      dst[i] = src[i] + pass;
+
+  for (i = 0; i < WORDS; i += 1024)
+    sum += dst[i];
+
+  printf("stream_copy %d\n", sum);
+  return 0;
+}
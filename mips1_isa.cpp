@@ -38,6 +38,28 @@
 #include  "mips1_isa_init.cpp"
 #include  "mips1_bhv_macros.H"
 #include  "mc723.h"
+#include  "mc723_hotspot.h"
+#include  "mc723_callgraph.h"
+#include  "mc723_reuse.h"
+#include  "mc723_mix.h"
+#include  "mc723_timing.h"
+#include  "mc723_coherence.h"
+#include  "mc723_threec.h"
+#include  "mc723_energy.h"
+#include  "mc723_waypred.h"
+#include  "mc723_frontend.h"
+#include  "mc723_spm.h"
+#include  "mc723_telemetry.h"
+#include  "mc723_ooo.h"
+#include  "mc723_replace.h"
+#include  "mc723_mshr.h"
+#include  "mc723_ksweep.h"
+#include  "mc723_native.h"
+#include  "mc723_selfprof.h"
+#include  "mc723_compress.h"
+
+// Every profiled event goes to all the profilers
+#define PROFILE_EVENT(PC, EVENT, N) do { HOTSPOT_RECORD(PC, EVENT, N); CALLGRAPH_RECORD(EVENT, N); } while (0)
 
 //If you want debug information for this model, uncomment next line
 //#define DEBUG_MODEL
@@ -47,12 +69,23 @@
 //!User defined macros to reference registers.
 #define Ra 31
 #define Sp 29
-int hazardCount;
-int dataCacheMiss;
-int memAccessCount;
-int instructionCacheMiss;
-int instructionCount;
-int unalignedAccess;
+unsigned long long hazardCount;
+unsigned long long dataCacheMiss;
+unsigned long long memAccessCount;
+unsigned long long instructionCacheMiss;
+unsigned long long instructionCount;
+unsigned long long unalignedAccess;
+
+#ifdef TELEMETRY
+// instructionCount at the last update; native calls add many at once
+unsigned long long telemetryLastCount;
+
+void telemetryUpdate (bool finished) {
+  telemetryLastCount = instructionCount;
+  telemetryPublish(instructionCount, memAccessCount, dataCacheMiss, instructionCacheMiss,
+                   twoBitHitCount + twoBitMissCount, twoBitMissCount, hazardCount, finished);
+}
+#endif
 
 // 'using namespace' statement to allow access to all
 // mips1-specific datatypes
@@ -60,6 +93,24 @@ using namespace mips1_parms;
 
 void createContext (int r_dest, int r_read1, int r_read2, InstructionType type) {
 
+#ifdef DECOUPLED_TIMING
+  if (timingThread < 0) {
+    timingEvent.r_dest = r_dest;
+    timingEvent.r_read1 = r_read1;
+    timingEvent.r_read2 = r_read2;
+    timingEvent.type = type;
+    timingEvent.flags |= TE_CONTEXT;
+    return;
+  }
+#endif
+
+#ifdef OOO_MODEL
+  oooContext(r_dest, r_read1, r_read2);
+#endif
+#ifdef MSHR_MODEL
+  mshrContext(mshr[currentCore], r_dest, r_read1, r_read2);
+#endif
+
   if (currentInstruction.type != UNITIALIZED) {
 	lastInstruction = currentInstruction;
   }
@@ -68,61 +119,154 @@ void createContext (int r_dest, int r_read1, int r_read2, InstructionType type)
   currentInstruction.r_read1 = r_read1;
   currentInstruction.r_read2 = r_read2;
   currentInstruction.type = type;
+
+#ifdef INSTRUCTION_MIX
+  mixDependencies(r_dest, r_read1, r_read2, type);
+#endif
 }
 
 void verifyHazard () {
+  SELF_PROFILE_SCOPE(SP_HAZARD);
+#ifdef DECOUPLED_TIMING
+  if (timingThread < 0) {
+    timingEvent.flags |= TE_HAZARD;
+    return;
+  }
+#endif
+
   if (lastInstruction.type == MEMORY_READ)
-      if (lastInstruction.r_dest == currentInstruction.r_read1 || lastInstruction.r_dest == currentInstruction.r_read2)
+      if (lastInstruction.r_dest == currentInstruction.r_read1 || lastInstruction.r_dest == currentInstruction.r_read2) {
           hazardCount++;
+          PROFILE_EVENT(currentPC, PE_HAZARD, 1);
+      }
 }
 
 /*---------------------------- CACHE ---------------------------*/
 
-void verifyCacheWrite (int addr) {
+void verifyCacheWrite (int addr, int size) {
+    SELF_PROFILE_SCOPE(SP_DATA_CACHE);
+#ifdef DECOUPLED_TIMING
+    if (timingThread < 0) {
+        timingEvent.memAddr = addr;
+        timingEvent.memSize = size;
+        timingEvent.flags |= TE_STORE;
+        return;
+    }
+#endif
+
+#ifdef SCRATCHPAD
+    if (spmAccess(addr))
+        return;
+#endif
+
     int addr_aux = addr >> DATA_BLOCK_OFFSET_SIZE_BITS;
     int tag = addr_aux >> DATA_CACHE_SIZE_BITS;
     int row = addr_aux & DATA_ROW_MASK;
+#if defined(THREE_C_MISSES) || defined(SPM_ANALYSIS) || defined(MSHR_MODEL)
+    unsigned long long missesBefore = dataCacheMiss;
+#endif
+
+#if CORES > 1
+    coherenceWrite(row, tag);
+#endif
+#ifdef ENERGY_MODEL
+    energyCounters.dataWrites++;
+#endif
+#ifdef WAY_PREDICTION
+    wayPredAccess(wayPred[currentCore], addr, currentPC, true);
+#endif
+#ifdef REPLACEMENT_STUDY
+    replaceAccess(dataReplace[currentCore], addr, true, currentPC);
+#endif
 
     if (dataCache[row].valid && dataCache[row].tag != tag) {
         dataCacheMiss++;
+        PROFILE_EVENT(currentPC, PE_DATA_MISS, 1);
     }
 
     dataCache[row].tag = tag;
     dataCache[row].dirty = true;
+
+#ifdef THREE_C_MISSES
+    threeCAccess(dataThreeC[currentCore], addr_aux, dataCacheMiss - missesBefore);
+#endif
+#ifdef SPM_ANALYSIS
+    spmProfile(addr, dataCacheMiss - missesBefore);
+#endif
+#ifdef MSHR_MODEL
+    mshrAccess(mshr[currentCore], addr, dataCacheMiss != missesBefore, true);
+#endif
     
     //verify unalignment
-    if (addr % 4 != 0) {
+    if (addr % size != 0) {
         unalignedAccess++;
 
         int block_offset = (addr >> BYTE_OFFSET_SIZE_BITS) & DATA_BLOCK_OFFSET_MASK;
 
-        // if the block is the last in cache row and the access is unaligned
-        if (block_offset == DATA_BLOCK_OFFSET_MASK) {
+        // if the block is the last in cache row and the access spills out of it
+        if (block_offset == DATA_BLOCK_OFFSET_MASK && addr % 4 + size > 4) {
             // verify the cache write of the next aligned block
             addr = (addr + 4) - (addr % 4);
-            verifyCacheWrite(addr);
+            verifyCacheWrite(addr, 4);
         }
     }
 }
 
-void verifyCacheRead (int addr) {
+void verifyCacheRead (int addr, int size) {
+    SELF_PROFILE_SCOPE(SP_DATA_CACHE);
+#ifdef DECOUPLED_TIMING
+    if (timingThread < 0) {
+        timingEvent.memAddr = addr;
+        timingEvent.memSize = size;
+        timingEvent.flags |= TE_LOAD;
+        return;
+    }
+#endif
+
+#ifdef SCRATCHPAD
+    if (spmAccess(addr))
+        return;
+#endif
+
     int addr_aux = addr >> DATA_BLOCK_OFFSET_SIZE_BITS;
     int tag = addr_aux >> DATA_CACHE_SIZE_BITS;
     int row = addr_aux & DATA_ROW_MASK;
+#if defined(THREE_C_MISSES) || defined(SPM_ANALYSIS) || defined(MSHR_MODEL)
+    unsigned long long missesBefore = dataCacheMiss;
+#endif
+
+#if CORES > 1
+    coherenceRead(row, tag);
+#endif
+#ifdef ENERGY_MODEL
+    energyCounters.dataReads++;
+#endif
+#ifdef WAY_PREDICTION
+    wayPredAccess(wayPred[currentCore], addr, currentPC, false);
+#endif
+#ifdef REPLACEMENT_STUDY
+    replaceAccess(dataReplace[currentCore], addr, false, currentPC);
+#endif
 
     // invalid row in cache: need to read from the memory
     if (!dataCache[row].valid) {
         dataCacheMiss++;
-        
+        PROFILE_EVENT(currentPC, PE_DATA_MISS, 1);
+
     } else {
         // need to replace the value. 2 misses: 1 for writing the dirty value, other for reading the memory        
         if (dataCache[row].dirty && dataCache[row].tag != tag) {
             dataCacheMiss += 2;
+            PROFILE_EVENT(currentPC, PE_DATA_MISS, 2);
+#ifdef ENERGY_MODEL
+            energyCounters.dataWritebacks++;
+#endif
         }
 
         // 1 miss for reading from the memory
         else if (!dataCache[row].dirty && dataCache[row].tag != tag) {
             dataCacheMiss++;
+            PROFILE_EVENT(currentPC, PE_DATA_MISS, 1);
         }
     }
 
@@ -130,33 +274,72 @@ void verifyCacheRead (int addr) {
     dataCache[row].valid = true;
     dataCache[row].tag = tag;
 
+#ifdef THREE_C_MISSES
+    threeCAccess(dataThreeC[currentCore], addr_aux, dataCacheMiss - missesBefore);
+#endif
+#ifdef SPM_ANALYSIS
+    spmProfile(addr, dataCacheMiss - missesBefore);
+#endif
+#ifdef MSHR_MODEL
+    mshrAccess(mshr[currentCore], addr, dataCacheMiss != missesBefore, false);
+#endif
+
     //verify unalignment
-    if (addr % 4 != 0) {
+    if (addr % size != 0) {
         unalignedAccess++;
 
         int block_offset = (addr >> BYTE_OFFSET_SIZE_BITS) & DATA_BLOCK_OFFSET_MASK;
 
-        // if the block is the last in cache row and the access is unaligned
-        if (block_offset == DATA_BLOCK_OFFSET_MASK) {
+        // if the block is the last in cache row and the access spills out of it
+        if (block_offset == DATA_BLOCK_OFFSET_MASK && addr % 4 + size > 4) {
             // verify the cache write of the next aligned block
             addr = (addr + 4) - (addr % 4);
-            verifyCacheRead(addr);
+            verifyCacheRead(addr, 4);
         }
     }
 }
 
 void verifyInstructionCache (int addr) {
+    SELF_PROFILE_SCOPE(SP_INSTRUCTION_CACHE);
+#ifdef DECOUPLED_TIMING
+    if (timingThread < 0) {
+        timingBegin(currentPC, addr);
+        return;
+    }
+#endif
+
+#ifdef OOO_MODEL
+    oooNext(currentCore, dataCacheMiss, instructionCacheMiss, twoBitMissCount);
+#endif
+#ifdef MSHR_MODEL
+    mshrInstruction(mshr[currentCore]);
+#endif
+
+    // served by the fetch (or loop) buffer
+    if (frontendFetch(frontend[currentCore], addr))
+        return;
+
     int addr_aux = addr >> INSTRUCTION_BLOCK_OFFSET_SIZE_BITS;
     int tag = addr_aux >> INSTRUCTION_CACHE_SIZE_BITS;
     int row = addr_aux & INSTRUCTION_ROW_MASK;
     
     // invalid row or diferent tag: need to read from the memory
-    if (!instructionCache[row].valid || instructionCache[row].tag != tag) {
+    bool miss = !instructionCache[row].valid || instructionCache[row].tag != tag;
+    if (miss) {
         instructionCacheMiss++;
+        PROFILE_EVENT(addr, PE_INSTRUCTION_MISS, 1);
     }
+#ifdef REPLACEMENT_STUDY
+    replaceAccess(instructionReplace[currentCore], addr, false, addr);
+#endif
+#ifdef THREE_C_MISSES
+    threeCAccess(instructionThreeC[currentCore], addr_aux, miss ? 1 : 0);
+#endif
 
     instructionCache[row].tag = tag;
     instructionCache[row].valid = true;
+
+    frontendProbe(frontend[currentCore], addr, row, miss);
 }
 
 /*-------------------------------------------------------*/
@@ -166,17 +349,56 @@ void ac_behavior( instruction )
 {
   dbg_printf("----- PC=%#x ----- %lld\n", (int) ac_pc, ac_instr_counter);
   //  dbg_printf("----- PC=%#x NPC=%#x ----- %lld\n", (int) ac_pc, (int)npc, ac_instr_counter);
+#if CORES > 1
+  coreSwitch(this);
+#endif
+  currentPC = ac_pc;
+#ifdef NATIVE_LIBC
+  // the native routine called by the previous instructions returns here
+  if (native[currentCore].pending >= 0 && currentPC == native[currentCore].returnAddr) {
+    RB[2] = nativeCall(native[currentCore], DM, RB[4], RB[5], RB[6], instructionCount, memAccessCount);
+#ifdef CALLGRAPH_PROFILER
+    callgraphReturn(currentPC);
+#endif
+  }
+#endif
+#ifdef NATIVE_CALIBRATE
+  nativeMeasure(native[currentCore], DM, currentPC, RB[4], RB[5], RB[6], RB[Ra], instructionCount);
+#endif
+#ifdef CALLGRAPH_PROFILER
+  callgraphInstruction();
+#endif
 #ifndef NO_NEED_PC_UPDATE
   ac_pc = npc;
   npc = ac_pc + 4;
 #endif
+#ifdef NATIVE_LIBC
+  // a jump into a native routine goes straight to its return address
+  if (ac_pc != currentPC + 4 && nativeRedirect(native[currentCore], ac_pc, RB[Ra])) {
+    ac_pc = RB[Ra];
+    npc = ac_pc + 4;
+  }
+#endif
 
   verifyInstructionCache((int)ac_pc);
   instructionCount++;
+#ifdef TELEMETRY
+  if (instructionCount - telemetryLastCount >= TELEMETRY_INTERVAL)
+    telemetryUpdate(false);
+#endif
 };
  
 //! Instruction Format behavior methods.
 void ac_behavior( Type_R ){
+  MIX_RECORD((rd | func) == 0 ? MIX_NOP : MIX_FUNCT + func);
+#if defined(INSTRUCTION_MIX) && defined(DECOUPLED_TIMING)
+  // mixHiLo reads the clock of mixDependencies, so it runs next to it
+  timingEvent.func = func;
+  timingEvent.flags |= TE_HILO;
+#elif defined(INSTRUCTION_MIX)
+  mixHiLo(func);
+#endif
+
   if (rd == 0) rd = NOT_USED;
   
   createContext (rd, rs, rt, NORMAL_INST);
@@ -184,48 +406,96 @@ void ac_behavior( Type_R ){
 }
 
 void ac_behavior( Type_J ){ 
+  MIX_RECORD(MIX_OPCODE + op);
   createContext (NOT_USED, NOT_USED, NOT_USED, NORMAL_INST);
 }
 
+// Natural width of a load or store, for the unaligned count. lwl/lwr and
+// swl/swr are the two halves of an unaligned word access (ulw/usw), so
+// they count as words: unaligned when addr % 4 != 0, and the one in the
+// last word of a line brings in the next line like a misaligned lw
+static inline int memAccessSize (unsigned int op) {
+  switch (op & 7) {
+    case 0: case 4: return 1;   // lb, lbu, sb
+    case 1: case 5: return 2;   // lh, lhu, sh
+    default:        return 4;   // lw, sw, lwl, lwr, swl, swr
+  }
+}
+
 void ac_behavior( Type_I_MEMREAD ){
+  MIX_RECORD(MIX_OPCODE + op);
   createContext (rt, rs, NOT_USED, MEMORY_READ);
   verifyHazard();
 
-  verifyCacheRead(RB[rs]);
+#if defined(SCRATCHPAD) || defined(SPM_ANALYSIS)
+  spmStackPointer(RB[Sp]);
+  if (rs == Sp)
+    spmStackAccess(RB[rs] + imm);
+#endif
+  verifyCacheRead(RB[rs] + imm, memAccessSize(op));
+#ifdef REUSE_DISTANCE
+  reuseAccess(RB[rs] + imm);
+#endif
+#ifdef OOO_MODEL
+  oooMemory(RB[rs] + imm, false);
+#endif
+#ifdef COMPRESSED_CACHE
+  compressAccess(compress[currentCore], DM, RB[rs] + imm, false);
+#endif
 
   memAccessCount++;
 }
 
 void ac_behavior( Type_I_MEMWRITE ){
+  MIX_RECORD(MIX_OPCODE + op);
   createContext (NOT_USED, rs, rt, NORMAL_INST);
   verifyHazard();
 
-  verifyCacheWrite(RB[rs]);
+#if defined(SCRATCHPAD) || defined(SPM_ANALYSIS)
+  spmStackPointer(RB[Sp]);
+  if (rs == Sp)
+    spmStackAccess(RB[rs] + imm);
+#endif
+  verifyCacheWrite(RB[rs] + imm, memAccessSize(op));
+#ifdef REUSE_DISTANCE
+  reuseAccess(RB[rs] + imm);
+#endif
+#ifdef OOO_MODEL
+  oooMemory(RB[rs] + imm, true);
+#endif
+#ifdef COMPRESSED_CACHE
+  compressAccess(compress[currentCore], DM, RB[rs] + imm, true);
+#endif
 
   memAccessCount++;
 }
 
 void ac_behavior( Type_I_RR ){
+  MIX_RECORD(MIX_OPCODE + op);
   createContext (NOT_USED, rs, rt, NORMAL_INST);
   verifyHazard();
 }
 
 void ac_behavior( Type_I_WR ){
+  MIX_RECORD(MIX_OPCODE + op);
   createContext (rt, rs, NOT_USED, NORMAL_INST);
   verifyHazard();
 }
 
 void ac_behavior( Type_I_W ){
+  MIX_RECORD(MIX_OPCODE + op);
   createContext (rt, NOT_USED, NOT_USED, NORMAL_INST);
   verifyHazard();
 }
 
 void ac_behavior( Type_I_R ){
+  MIX_RECORD(op == 1 ? MIX_REGIMM + rt : MIX_OPCODE + op);
   createContext (NOT_USED, rs, NOT_USED, NORMAL_INST);
   verifyHazard();
 }
 
 void ac_behavior( Type_I_W31 ){
+  MIX_RECORD(MIX_REGIMM + rt);
   createContext (31, rs, NOT_USED, NORMAL_INST);
   verifyHazard();
 }
@@ -234,6 +504,9 @@ void ac_behavior( Type_I_W31 ){
 void ac_behavior(begin)
 {
   dbg_printf("@@@ begin behavior @@@\n");
+#if CORES > 1
+  coreRegister(this);
+#endif
   RB[0] = 0;
   npc = ac_pc + 4;
 
@@ -258,6 +531,7 @@ void ac_behavior(begin)
       instructionCache[i].valid = false;
       instructionCache[i].tag = -1;
   }
+  frontendInit(frontend[currentCore]);
   
   dataCacheMiss = 0;
   memAccessCount = 0;
@@ -274,21 +548,102 @@ void ac_behavior(begin)
   oneBitMissCount = 0;
   twoBitHitCount = 0;
   twoBitMissCount = 0;
+#if CORES > 1
+  coreResetMark();
+#endif
+
+#ifdef HOTSPOT_PROFILER
+  hotspotInit();
+#endif
+#ifdef CALLGRAPH_PROFILER
+  callgraphInit(ac_pc);
+#endif
+#ifdef REUSE_DISTANCE
+  reuseInit();
+#endif
+#ifdef INSTRUCTION_MIX
+  mixInit();
+#endif
+#ifdef ENERGY_MODEL
+  energyInit();
+#endif
+#if defined(SCRATCHPAD) || defined(SPM_ANALYSIS)
+  spmInit();
+#endif
+#ifdef TELEMETRY
+  telemetryLastCount = 0;
+  telemetryInit(findLoadedProgram().c_str());
+#endif
+#ifdef WAY_PREDICTION
+  wayPredInit(wayPred[currentCore]);
+#endif
+#ifdef OOO_MODEL
+  oooInit(oooCore[currentCore]);
+#endif
+#if defined(NATIVE_LIBC) || defined(NATIVE_CALIBRATE)
+  nativeInit(native[currentCore]);
+#endif
+#ifdef PREDICTOR_SWEEP
+  kSweepInit(kSweep[currentCore]);
+#endif
+#ifdef MSHR_MODEL
+  mshrInit(mshr[currentCore]);
+#endif
+#ifdef COMPRESSED_CACHE
+  compressInit(compress[currentCore]);
+#endif
+#ifdef REPLACEMENT_STUDY
+  replaceInit(dataReplace[currentCore], "data cache", DATA_CACHE_SIZE, DATA_BLOCK_OFFSET_SIZE_BITS);
+  replaceInit(instructionReplace[currentCore], "instruction cache", INSTRUCTION_CACHE_SIZE,
+              INSTRUCTION_BLOCK_OFFSET_SIZE_BITS);
+#endif
+#ifdef THREE_C_MISSES
+  threeCInit(dataThreeC[currentCore], "data cache", DATA_CACHE_SIZE, DATA_BLOCK_OFFSET_SIZE_BITS);
+  threeCInit(instructionThreeC[currentCore], "instruction cache", INSTRUCTION_CACHE_SIZE,
+             INSTRUCTION_BLOCK_OFFSET_SIZE_BITS);
+#endif
+#ifdef DECOUPLED_TIMING
+  timingStart();
+#endif
+#ifdef SELF_PROFILE
+  selfProfileStart();
+#endif
 }
 
 //!Behavior called after finishing simulation
 void ac_behavior(end)
 {
-  printf ("hazard count = %d\n\n", hazardCount);
+#if CORES > 1
+  // the counters are totals of every core, so they are only printed by
+  // the last one; coherenceReport splits them per core
+  if (!coreFinish(this))
+    return;
+#endif
+
+#ifdef SELF_PROFILE
+  selfProfileStop();
+#endif
+#ifdef DECOUPLED_TIMING
+  timingStop();
+#endif
+#ifdef OOO_MODEL
+  oooFinish(dataCacheMiss, instructionCacheMiss, twoBitMissCount);
+#endif
+#ifdef TELEMETRY
+  telemetryUpdate(true);
+  telemetryFinish();
+#endif
+
+  printf ("hazard count = %llu\n\n", hazardCount);
 
   // cache
-  printf ("data cache miss= %d\n", dataCacheMiss);
-  printf ("memory access= %d\n", memAccessCount);
+  printf ("data cache miss= %llu\n", dataCacheMiss);
+  printf ("memory access= %llu\n", memAccessCount);
   printf ("dataMiss/memAccess=%lf\n\n", (double) dataCacheMiss/ (double) memAccessCount);
-  printf("instructionMiss=%d\n", instructionCacheMiss);
-  printf("instructionCount=%d\n", instructionCount);
+  printf("instructionMiss=%llu\n", instructionCacheMiss);
+  printf("instructionCount=%llu\n", instructionCount);
   printf("instructionMiss/instructionCount=%lf\n", (double) instructionCacheMiss/ (double) instructionCount);
-  printf("unalignedAccesses=%d\n", unalignedAccess);
+  printf("unalignedAccesses=%llu\n", unalignedAccess);
 
   // bench predictor
   FILE * fp = fopen("../bench.txt", "a");
@@ -301,6 +656,58 @@ void ac_behavior(end)
   printf("- One-bit prediction: [ %llu ] hits and [ %llu ] misses\n", oneBitHitCount, oneBitMissCount);
   printf("- Two-bits prediction: [ %llu ] hits and [ %llu ] misses\n", twoBitHitCount, twoBitMissCount);
   printf("*****************************************************************\n");
+
+#if CORES > 1
+  coherenceReport();
+#endif
+#ifdef HOTSPOT_PROFILER
+  hotspotReport();
+#endif
+#ifdef CALLGRAPH_PROFILER
+  callgraphReport();
+#endif
+#ifdef REUSE_DISTANCE
+  reuseReport();
+#endif
+#ifdef INSTRUCTION_MIX
+  mixReport();
+#endif
+#ifdef THREE_C_MISSES
+  threeCReport();
+#endif
+#ifdef REPLACEMENT_STUDY
+  replaceReport(dataCacheMiss, instructionCacheMiss);
+#endif
+#ifdef WAY_PREDICTION
+  wayPredReport(dataCacheMiss);
+#endif
+#ifdef FRONTEND_MODEL
+  frontendReport();
+#endif
+#if defined(SCRATCHPAD) || defined(SPM_ANALYSIS)
+  spmReport(memAccessCount, dataCacheMiss);
+#endif
+#ifdef ENERGY_MODEL
+  energyReport(instructionCount, frontendProbes(), hazardCount, dataCacheMiss, instructionCacheMiss);
+#endif
+#ifdef OOO_MODEL
+  oooReport(instructionCount, hazardCount, dataCacheMiss, instructionCacheMiss, twoBitMissCount);
+#endif
+#ifdef MSHR_MODEL
+  mshrReport(hazardCount);
+#endif
+#ifdef PREDICTOR_SWEEP
+  kSweepReport();
+#endif
+#if defined(NATIVE_LIBC) || defined(NATIVE_CALIBRATE)
+  nativeReport();
+#endif
+#ifdef COMPRESSED_CACHE
+  compressReport();
+#endif
+#ifdef SELF_PROFILE
+  selfProfileReport();
+#endif
   
   dbg_printf("@@@ end behavior @@@\n");
 }
@@ -361,6 +768,14 @@ void ac_behavior( lwl )
   ac_Uword data;
 
   addr = RB[rs] + imm;
+
+  // aligned: the whole word is loaded
+  if ((addr & 0x3) == 0) {
+    RB[rt] = DM.read(addr);
+    dbg_printf("Result = %#x\n", RB[rt]);
+    return;
+  }
+
   offset = (addr & 0x3) * 8;
   data = DM.read(addr & 0xFFFFFFFC);
   data <<= offset;
@@ -377,6 +792,15 @@ void ac_behavior( lwr )
   ac_Uword data;
 
   addr = RB[rs] + imm;
+
+  // last byte of the word: the whole word is loaded (and a shift by 32
+  // below would be undefined)
+  if ((addr & 0x3) == 3) {
+    RB[rt] = DM.read(addr & 0xFFFFFFFC);
+    dbg_printf("Result = %#x\n", RB[rt]);
+    return;
+  }
+
   offset = (3 - (addr & 0x3)) * 8;
   data = DM.read(addr & 0xFFFFFFFC);
   data >>= offset;
@@ -417,15 +841,29 @@ void ac_behavior( sw )
 void ac_behavior( swl )
 {
   dbg_printf("swl r%d, %d(r%d)\n", rt, imm & 0xFFFF, rs);
-  unsigned int addr, offset;
+  unsigned int addr;
   ac_Uword data;
 
   addr = RB[rs] + imm;
-  offset = (addr & 0x3) * 8;
   data = RB[rt];
-  data >>= offset;
-  data |= DM.read(addr & 0xFFFFFFFC) & (0xFFFFFFFF << (32-offset));
-  DM.write(addr & 0xFFFFFFFC, data);
+
+  // Only the bytes from addr to the end of the word change, so they are
+  // stored directly instead of reading and writing back the whole word
+  switch (addr & 0x3) {
+  case 0:
+    DM.write(addr, data);
+    break;
+  case 1:
+    DM.write_byte(addr, data >> 24);
+    DM.write_half(addr + 1, data >> 8);
+    break;
+  case 2:
+    DM.write_half(addr, data >> 16);
+    break;
+  case 3:
+    DM.write_byte(addr, data >> 24);
+    break;
+  }
   dbg_printf("Result = %#x\n", data);
 };
 
@@ -433,15 +871,28 @@ void ac_behavior( swl )
 void ac_behavior( swr )
 {
   dbg_printf("swr r%d, %d(r%d)\n", rt, imm & 0xFFFF, rs);
-  unsigned int addr, offset;
+  unsigned int addr;
   ac_Uword data;
 
   addr = RB[rs] + imm;
-  offset = (3 - (addr & 0x3)) * 8;
   data = RB[rt];
-  data <<= offset;
-  data |= DM.read(addr & 0xFFFFFFFC) & ((1<<offset)-1);
-  DM.write(addr & 0xFFFFFFFC, data);
+
+  // Only the bytes from the start of the word to addr change
+  switch (addr & 0x3) {
+  case 0:
+    DM.write_byte(addr, data);
+    break;
+  case 1:
+    DM.write_half(addr - 1, data);
+    break;
+  case 2:
+    DM.write_half(addr - 2, data >> 8);
+    DM.write_byte(addr, data);
+    break;
+  case 3:
+    DM.write(addr - 3, data);
+    break;
+  }
   dbg_printf("Result = %#x\n", data);
 };
 
@@ -799,6 +1250,9 @@ void ac_behavior( jal )
 #ifndef NO_NEED_PC_UPDATE
   npc = (ac_pc & 0xF0000000) | addr;
 #endif 
+#ifdef CALLGRAPH_PROFILER
+  callgraphCall((ac_pc & 0xF0000000) | addr, ac_pc+4);
+#endif
 	
   dbg_printf("Target = %#x\n", (ac_pc & 0xF0000000) | addr );
   dbg_printf("Return = %#x\n", ac_pc+4);
@@ -813,6 +1267,10 @@ void ac_behavior( jr )
 #ifndef NO_NEED_PC_UPDATE
   npc = RB[rs], 1;
 #endif 
+#ifdef CALLGRAPH_PROFILER
+  if (rs == Ra)
+    callgraphReturn(RB[rs]);
+#endif
   dbg_printf("Target = %#x\n", RB[rs]);
 };
 
@@ -826,6 +1284,9 @@ void ac_behavior( jalr )
 #ifndef NO_NEED_PC_UPDATE
   npc = RB[rs], 1;
 #endif 
+#ifdef CALLGRAPH_PROFILER
+  callgraphCall(RB[rs], ac_pc+4);
+#endif
   dbg_printf("Target = %#x\n", RB[rs]);
 
   if( rd == 0 )  //If rd is not defined use default
@@ -840,6 +1301,22 @@ void ac_behavior( jalr )
  * It makes all the necessary computation for the branch predictions penalties.
  */
 void branchTaken(unsigned int ac_pc, unsigned int jmp_addr) {
+  SELF_PROFILE_SCOPE(SP_BRANCH);
+
+#ifdef DECOUPLED_TIMING
+  if (timingThread < 0) {
+    timingEvent.branchTarget = jmp_addr;
+    timingEvent.flags |= TE_TAKEN;
+    return;
+  }
+#endif
+
+#ifdef INSTRUCTION_MIX
+  mixBranchOutcome(currentPC, 1);
+#endif
+#ifdef PREDICTOR_SWEEP
+  kSweepBranch(kSweep[currentCore], ac_pc, jmp_addr, true);
+#endif
 
   // Always taken hit
   alwaysTakenHitCount++;
@@ -878,11 +1355,13 @@ void branchTaken(unsigned int ac_pc, unsigned int jmp_addr) {
       twoBitPredictor[PRED_INDEX(ac_pc)].jump_to = jmp_addr;
 
     twoBitMissCount++;
+    PROFILE_EVENT(currentPC, PE_BRANCH_MISPREDICT, 1);
   }
 
   // If the predictor says that it will jump to the wrong address
   else if (twoBitPredictor[PRED_INDEX(ac_pc)].jump_to != jmp_addr) {
     twoBitMissCount++;
+    PROFILE_EVENT(currentPC, PE_BRANCH_MISPREDICT, 1);
     twoBitPredictor[PRED_INDEX(ac_pc)].jump_to = jmp_addr;
     
     // Updating states
@@ -905,6 +1384,22 @@ void branchTaken(unsigned int ac_pc, unsigned int jmp_addr) {
  * It makes all the necessary computatation for the branch prediction penalties.
  */
 void branchNotTaken(unsigned int ac_pc, unsigned int jmp_addr) {
+  SELF_PROFILE_SCOPE(SP_BRANCH);
+
+#ifdef DECOUPLED_TIMING
+  if (timingThread < 0) {
+    timingEvent.branchTarget = jmp_addr;
+    timingEvent.flags |= TE_NOT_TAKEN;
+    return;
+  }
+#endif
+
+#ifdef INSTRUCTION_MIX
+  mixBranchOutcome(currentPC, 0);
+#endif
+#ifdef PREDICTOR_SWEEP
+  kSweepBranch(kSweep[currentCore], ac_pc, jmp_addr, false);
+#endif
 
   // One mis for the always taken strategy
   alwaysTakenMissCount++;
@@ -937,6 +1432,7 @@ void branchNotTaken(unsigned int ac_pc, unsigned int jmp_addr) {
     // Updating BTB address
     twoBitPredictor[PRED_INDEX(ac_pc)].jump_to = (twoBitPredictor[PRED_INDEX(ac_pc)].state == TAKEN_0 ? jmp_addr : ac_pc + 4);
     twoBitMissCount++;
+    PROFILE_EVENT(currentPC, PE_BRANCH_MISPREDICT, 1);
   }
   else {
     twoBitHitCount++;
@@ -945,6 +1441,40 @@ void branchNotTaken(unsigned int ac_pc, unsigned int jmp_addr) {
   }
 }
 
+#ifdef DECOUPLED_TIMING
+/*
+ * Runs the models for one instruction on a timing thread, in the same
+ * order the behaviors call them. The branch helpers get ac_pc + 4 as
+ * they would inside the branch behavior.
+ */
+void timingReplay (int thread, const TimingEvent &e) {
+  currentPC = e.pc;
+
+  if (thread == 0) {
+    verifyInstructionCache(e.fetchAddr);
+#ifdef INSTRUCTION_MIX
+    if (e.flags & TE_HILO)
+      mixHiLo(e.func);
+#endif
+    if (e.flags & TE_CONTEXT)
+      createContext(e.r_dest, e.r_read1, e.r_read2, (InstructionType) e.type);
+    if (e.flags & TE_HAZARD)
+      verifyHazard();
+    if (e.flags & TE_LOAD)
+      verifyCacheRead(e.memAddr, e.memSize);
+    if (e.flags & TE_STORE)
+      verifyCacheWrite(e.memAddr, e.memSize);
+  }
+
+  if (thread == TIMING_THREADS - 1) {
+    if (e.flags & TE_TAKEN)
+      branchTaken(e.pc + 4, e.branchTarget);
+    else if (e.flags & TE_NOT_TAKEN)
+      branchNotTaken(e.pc + 4, e.branchTarget);
+  }
+}
+#endif
+
 /*******************************************************
  * For all the branch instruction, we called the branchTaken() function
  * when the branch is taken, with the current PC and the offset of the jump
@@ -1058,6 +1588,9 @@ void ac_behavior( bltzal )
 #endif 
     dbg_printf("Taken to %#x\n", ac_pc + (imm<<2));
     branchTaken(ac_pc, ac_pc + (imm<<2));
+#ifdef CALLGRAPH_PROFILER
+    callgraphCall(ac_pc + (imm<<2), ac_pc+4);
+#endif
   }
   else {
     branchNotTaken(ac_pc, ac_pc + (imm<<2));
@@ -1076,6 +1609,9 @@ void ac_behavior( bgezal )
 #endif 
     dbg_printf("Taken to %#x\n", ac_pc + (imm<<2));
     branchTaken(ac_pc, imm << 2);
+#ifdef CALLGRAPH_PROFILER
+    callgraphCall(ac_pc + (imm<<2), ac_pc+4);
+#endif
   }	
   else {
     branchNotTaken(ac_pc, imm << 2);
@@ -0,0 +1,486 @@
+#!/usr/bin/env python3
+"""Synthetic MIPS kernels with analytically known model counters.
+
+Generates small assembly programs that stress one model at a time, each
+with the miss, mispredict or hazard rate the models of mips1_isa.cpp must
+report for it, then runs them and checks the rates:
+
+  ./synth.py suite                           # micro/synth/*.s and *.json
+  ./synth.py gen chase --footprint 1536 --order random --name chase_1k5
+  make synth                                 # suite + cross compile
+  ./synth.py check                           # or make synth-check
+  ./synth.py check --only chase_big,branch_p90
+
+Kernels:
+  stride   independent loads over --footprint bytes, --stride apart
+  chase    dependent loads through a ring of nodes --stride apart, visited
+           in address order or in one random cycle (--order random)
+  stream   stores over --footprint bytes, --stride apart
+  branch   a branch taken with probability --taken (xorshift32), or
+           following a periodic --pattern such as 1101000
+  loaduse  chains of --chain dependent loads with --distance independent
+           instructions between each load and its use
+
+The expectations follow the models as they are written: a direct-mapped
+data cache of DATA_CACHE_SIZE lines (read from mc723.h) where a read
+always fills and a store only counts a miss on a valid row of another
+tag, the load-use hazard of verifyHazard (adjacent instructions only), and
+the one-bit and two-bit predictors. Each pass over a footprint misses on
+every line that shares its row with another line of the pass and hits on
+the others; random cycles and sequential strides both revisit a line only
+after every other line, so the same count holds for both.
+
+Every kernel has a twin, <name>.once.s, with the same data and a single
+pass (or iteration). The crt startup, which zeroes a .bss as big as the
+kernel's, and the exit path, which runs after the same cache state, are
+the same in both, so check subtracts the counters of the twin and what is
+left are the passes 2..N alone. The branch outcomes are replayed exactly
+(xorshift32 included), so the expectations are exact and the tolerance is
+only relative. check runs from the mips folder, like bench.py, and prints
+the simulation speed of each kernel too.
+"""
+
+import argparse
+import collections
+import copy
+import glob
+import json
+import math
+import os
+import random
+import re
+import subprocess
+import sys
+import time
+
+import bench
+
+SYNTH_DIR = 'micro/synth'
+
+# |measured - expected| must be at most REL_TOLERANCE * expected; the
+# expectations are exact, this only absorbs rounding
+REL_TOLERANCE = 0.001
+
+# metric -> (counters added for the numerator, counters added for the denominator)
+METRICS = {
+    'data miss rate': (['data cache miss'], ['memory access']),
+    'hazards per access': (['hazard count'], ['memory access']),
+    'always taken miss rate': (['Always taken misses'], ['Always taken hits', 'Always taken misses']),
+    'never taken miss rate': (['Never taken misses'], ['Never taken hits', 'Never taken misses']),
+    'one-bit miss rate': (['One-bit prediction misses'],
+                          ['One-bit prediction hits', 'One-bit prediction misses']),
+    'two-bit miss rate': (['Two-bits prediction misses'],
+                          ['Two-bits prediction hits', 'Two-bits prediction misses']),
+}
+
+
+def read_geometry(header='mc723.h'):
+    """(lines, line bytes) of the data cache."""
+    defines = {}
+    with open(header) as f:
+        for line in f:
+            m = re.match(r'\s*#define\s+(\w+)\s+(\d+)\b', line)
+            if m:
+                defines[m.group(1)] = int(m.group(2))
+    return defines['DATA_CACHE_SIZE'], 1 << defines['DATA_BLOCK_OFFSET_SIZE_BITS']
+
+
+def conflict_lines(lines, rows):
+    """Lines of a pass that miss on every pass: those sharing their row with another."""
+    per_row = collections.Counter(line % rows for line in set(lines))
+    return sum(n for n in per_row.values() if n > 1)
+
+
+def align_bits(rows, line_bytes):
+    """Buffers start on a multiple of the cache size, so offset 0 is row 0."""
+    return max(int(math.log2(rows * line_bytes)), 4)
+
+
+def predictor_misses(outcomes):
+    """Misses of the always taken, never taken, one-bit and two-bit predictors
+    on one static branch, starting from the zeroed tables.
+
+    With a single target the BTB is always right when the direction is, so
+    the one-bit and two-bit predictors reduce to their state machines.
+    """
+    one, two = False, 0
+    always = never = one_misses = two_misses = 0
+    for taken in outcomes:
+        always += not taken
+        never += taken
+        one_misses += one != taken
+        two_misses += (two >= 2) != taken
+        one = taken
+        two = min(two + 1, 3) if taken else max(two - 1, 0)
+    return always, never, one_misses, two_misses
+
+
+def xorshift_outcomes(seed, threshold, n):
+    """Outcomes of the random branch kernel: xorshift32 below threshold."""
+    x, out = seed, []
+    for _ in range(n):
+        x ^= (x << 13) & 0xFFFFFFFF
+        x ^= x >> 17
+        x ^= (x << 5) & 0xFFFFFFFF
+        out.append(x < threshold)
+    return out
+
+
+def prologue(name, params):
+    return ['# %s: generated by synth.py, do not edit' % name,
+            '# ' + ' '.join('%s=%s' % kv for kv in sorted(params.items())),
+            '\t.set noreorder',
+            '\t.text',
+            '\t.globl main',
+            '\t.ent main',
+            'main:']
+
+
+def epilogue():
+    return ['\tjr $ra',
+            '\tmove $v0, $zero',
+            '\t.end main']
+
+
+def bss(label, size, bits):
+    return ['\t.section .bss',
+            '\t.align %d' % bits,
+            '%s:' % label,
+            '\t.space %d' % size]
+
+
+def ring(label, offsets, spacing, bits):
+    """A .data ring of nodes spacing bytes apart; node offsets[i] points to offsets[i + 1]."""
+    succ = {}
+    for i, off in enumerate(offsets):
+        succ[off] = offsets[(i + 1) % len(offsets)]
+    out = ['\t.data', '\t.align %d' % bits, '%s:' % label]
+    for off in range(0, len(offsets) * spacing, spacing):
+        out.append('\t.word %s+%d' % (label, succ[off]))
+        if spacing > 4:
+            out.append('\t.space %d' % (spacing - 4))
+    return out
+
+
+def check_sizes(footprint, stride):
+    if stride < 4 or stride % 4 or footprint % stride or footprint < stride:
+        sys.exit('the stride must be a multiple of 4 that divides the footprint')
+
+
+def kernel_stride(a, rows, line_bytes):
+    check_sizes(a.footprint, a.stride)
+    n = a.footprint // a.stride
+    lines = [off // line_bytes for off in range(0, a.footprint, a.stride)]
+    cold, steady = len(set(lines)), conflict_lines(lines, rows)
+    body = ['\tla $t8, buf',
+            '\taddu $t1, $t8, %d' % a.footprint,
+            '\tli $t7, %d' % a.stride,
+            '\tli $t9, %d' % a.passes,
+            'pass:',
+            '\tmove $t0, $t8',
+            'inner:',
+            '\tlw $t2, 0($t0)',
+            '\taddu $t0, $t0, $t7',
+            '\tbne $t0, $t1, inner',
+            '\tnop',
+            '\taddiu $t9, $t9, -1',
+            '\tbne $t9, $zero, pass',
+            '\tnop']
+    counts = {
+        'data miss rate': (cold + (a.passes - 1) * steady, n * a.passes),
+        'hazards per access': (0, n * a.passes),
+    }
+    return body, bss('buf', a.footprint, align_bits(rows, line_bytes)), counts, (4 * n + 4) * a.passes
+
+
+def kernel_chase(a, rows, line_bytes):
+    check_sizes(a.footprint, a.stride)
+    n = a.footprint // a.stride
+    offsets = [i * a.stride for i in range(n)]
+    if a.order == 'random':
+        if a.stride % line_bytes:
+            sys.exit('a random chase needs a stride multiple of the %d byte line' % line_bytes)
+        # Sattolo's shuffle: one cycle through every node
+        rng = random.Random(a.seed)
+        for i in range(n - 1, 0, -1):
+            j = rng.randrange(i)
+            offsets[i], offsets[j] = offsets[j], offsets[i]
+    lines = [off // line_bytes for off in offsets]
+    cold, steady = len(set(lines)), conflict_lines(lines, rows)
+    steps = n * a.passes
+    body = ['\tla $t0, buf',
+            '\tli $t9, %d' % steps,
+            'loop:',
+            '\tlw $t0, 0($t0)',
+            '\taddiu $t9, $t9, -1',
+            '\tbne $t9, $zero, loop',
+            '\tnop']
+    counts = {
+        'data miss rate': (cold + (a.passes - 1) * steady, steps),
+        'hazards per access': (0, steps),
+    }
+    return body, ring('buf', offsets, a.stride, align_bits(rows, line_bytes)), counts, 4 * steps
+
+
+def kernel_stream(a, rows, line_bytes):
+    check_sizes(a.footprint, a.stride)
+    n = a.footprint // a.stride
+    lines = [off // line_bytes for off in range(0, a.footprint, a.stride)]
+    cold, steady = len(set(lines)), conflict_lines(lines, rows)
+    bits = align_bits(rows, line_bytes)
+    # stores never validate a row, so one load per row first makes them all
+    # valid with the tags of warm
+    body = ['\tla $t0, warm',
+            '\taddu $t1, $t0, %d' % (rows * line_bytes),
+            'warmup:',
+            '\tlw $t2, 0($t0)',
+            '\taddiu $t0, $t0, %d' % line_bytes,
+            '\tbne $t0, $t1, warmup',
+            '\tnop',
+            '\tla $t8, buf',
+            '\taddu $t1, $t8, %d' % a.footprint,
+            '\tli $t7, %d' % a.stride,
+            '\tli $t9, %d' % a.passes,
+            'pass:',
+            '\tmove $t0, $t8',
+            'inner:',
+            '\tsw $zero, 0($t0)',
+            '\taddu $t0, $t0, $t7',
+            '\tbne $t0, $t1, inner',
+            '\tnop',
+            '\taddiu $t9, $t9, -1',
+            '\tbne $t9, $zero, pass',
+            '\tnop']
+    counts = {
+        'data miss rate': (rows + cold + (a.passes - 1) * steady, rows + n * a.passes),
+        'hazards per access': (0, rows + n * a.passes),
+    }
+    data = bss('warm', rows * line_bytes, bits) + bss('buf', a.footprint, bits)
+    return body, data, counts, 4 * rows + (4 * n + 4) * a.passes
+
+
+def kernel_branch(a, rows, line_bytes):
+    if a.pattern:
+        if not re.match(r'^[01]{1,31}$', a.pattern):
+            sys.exit('--pattern must be 1 to 31 characters 0 or 1')
+        pattern = [c == '1' for c in a.pattern]
+        period = len(pattern)
+        outcomes = [pattern[i % period] for i in range(a.iterations)]
+        bits = sum(1 << i for i, t in enumerate(pattern) if t)
+        # rotate the pattern right within its period; bit 0 is the outcome
+        step = ['\tandi $t3, $t5, 1',
+                '\tsrl $t2, $t5, 1',
+                '\tsll $t6, $t3, %d' % (period - 1),
+                '\tor $t5, $t2, $t6']
+        setup = ['\tli $t5, %d' % bits]
+    else:
+        threshold = min(int(a.taken * 2 ** 32), 2 ** 32 - 1)
+        outcomes = xorshift_outcomes(a.seed or 1, threshold, a.iterations)
+        step = ['\tsll $t2, $t0, 13',
+                '\txor $t0, $t0, $t2',
+                '\tsrl $t2, $t0, 17',
+                '\txor $t0, $t0, $t2',
+                '\tsll $t2, $t0, 5',
+                '\txor $t0, $t0, $t2',
+                '\tsltu $t3, $t0, $t1']
+        setup = ['\tli $t0, %d' % (a.seed or 1),
+                 '\tli $t1, %d' % threshold]
+    body = setup + ['\tli $t9, %d' % a.iterations,
+                    'loop:'] + step + [
+                    '\tbne $t3, $zero, skip',
+                    '\tnop',
+                    '\taddiu $t4, $t4, 1',
+                    'skip:',
+                    '\taddiu $t9, $t9, -1',
+                    '\tbne $t9, $zero, loop',
+                    '\tnop']
+    # the loop branch is taken but for the last iteration
+    kernel = predictor_misses(outcomes)
+    loop = predictor_misses([True] * (a.iterations - 1) + [False])
+    misses = [k + l for k, l in zip(kernel, loop)]
+    branches = 2 * a.iterations
+    counts = {
+        'always taken miss rate': (misses[0], branches),
+        'never taken miss rate': (misses[1], branches),
+        'one-bit miss rate': (misses[2], branches),
+        'two-bit miss rate': (misses[3], branches),
+    }
+    return body, [], counts, (len(step) + 6) * a.iterations - sum(outcomes)
+
+
+def kernel_loaduse(a, rows, line_bytes):
+    if a.chain < 1 or a.distance < 0:
+        sys.exit('--chain must be at least 1 and --distance at least 0')
+    check_sizes(a.footprint, a.stride)
+    n = a.footprint // a.stride
+    offsets = [i * a.stride for i in range(n)]
+    link = ['\tlw $t0, 0($t0)'] + ['\taddiu $t3, $t3, 1'] * a.distance
+    body = ['\tla $t0, buf',
+            '\tli $t9, %d' % a.iterations,
+            'loop:',
+            '\taddiu $t9, $t9, -1'] + link * a.chain + [
+            '\tbne $t9, $zero, loop',
+            '\tnop']
+    counts = {
+        'hazards per access': ((a.chain - 1) * a.iterations if a.distance == 0 else 0, a.chain * a.iterations),
+    }
+    data = ring('buf', offsets, a.stride, align_bits(rows, line_bytes))
+    return body, data, counts, (3 + a.chain * (1 + a.distance)) * a.iterations
+
+
+KERNELS = {
+    'stride': kernel_stride,
+    'chase': kernel_chase,
+    'stream': kernel_stream,
+    'branch': kernel_branch,
+    'loaduse': kernel_loaduse,
+}
+
+# name -> arguments of gen; sized for a few million simulated instructions
+SUITE = {
+    'stride_fit': ['stride', '--footprint', '512', '--stride', '4', '--passes', '8000'],
+    'stride_word': ['stride', '--footprint', '65536', '--stride', '4', '--passes', '40'],
+    'stride_line': ['stride', '--footprint', '65536', '--stride', '16', '--passes', '160'],
+    'stride_alias': ['stride', '--footprint', '8192', '--stride', '1024', '--passes', '100000'],
+    'chase_fit': ['chase', '--footprint', '1024', '--order', 'random', '--passes', '20000'],
+    'chase_1x5': ['chase', '--footprint', '1536', '--order', 'random', '--passes', '10000'],
+    'chase_big': ['chase', '--footprint', '262144', '--order', 'random', '--passes', '64'],
+    'chase_seq': ['chase', '--footprint', '65536', '--passes', '256'],
+    'stream_word': ['stream', '--footprint', '65536', '--stride', '4', '--passes', '40'],
+    'stream_fit': ['stream', '--footprint', '1024', '--stride', '4', '--passes', '2000'],
+    'branch_p50': ['branch', '--taken', '0.5', '--iterations', '400000'],
+    'branch_p90': ['branch', '--taken', '0.9', '--iterations', '400000'],
+    'branch_p99': ['branch', '--taken', '0.99', '--iterations', '400000'],
+    'branch_110': ['branch', '--pattern', '110', '--iterations', '400000'],
+    'branch_p16': ['branch', '--pattern', '1110100110010001', '--iterations', '400000'],
+    'loaduse_adjacent': ['loaduse', '--footprint', '512', '--chain', '8', '--iterations', '200000'],
+    'loaduse_spaced': ['loaduse', '--footprint', '512', '--chain', '8', '--distance', '1', '--iterations', '200000'],
+}
+
+
+def gen_parser():
+    p = argparse.ArgumentParser(prog='synth.py gen', description='generate one kernel')
+    p.add_argument('kernel', choices=sorted(KERNELS))
+    p.add_argument('--name', help='output name (default: the kernel)')
+    p.add_argument('--dir', default=SYNTH_DIR)
+    p.add_argument('--footprint', type=int, default=65536, help='bytes (default 65536)')
+    p.add_argument('--stride', type=int, default=16, help='bytes between accesses (default 16)')
+    p.add_argument('--passes', type=int, default=16, help='passes over the footprint (default 16)')
+    p.add_argument('--order', choices=['stride', 'random'], default='stride', help='chase order')
+    p.add_argument('--seed', type=int, default=723)
+    p.add_argument('--taken', type=float, default=0.5, help='branch taken probability')
+    p.add_argument('--pattern', help='periodic branch outcomes, first one first')
+    p.add_argument('--iterations', type=int, default=400000)
+    p.add_argument('--chain', type=int, default=8, help='dependent loads per iteration')
+    p.add_argument('--distance', type=int, default=0, help='instructions from a load to its use')
+    return p
+
+
+def generate(argv, name=None):
+    a = gen_parser().parse_args(argv)
+    name = name or a.name or a.kernel
+    if a.passes < 2 or a.iterations < 2:
+        sys.exit('--passes and --iterations must be at least 2, the first one is subtracted')
+    rows, line_bytes = read_geometry()
+    body, data, counts, instructions = KERNELS[a.kernel](a, rows, line_bytes)
+
+    # the twin: same data, so the same startup, and a single pass
+    once = copy.copy(a)
+    once.passes = once.iterations = 1
+    once_body, once_data, once_counts, _ = KERNELS[a.kernel](once, rows, line_bytes)
+    assert once_data == data
+    expected = {}
+    for metric, (num, den) in counts.items():
+        expected[metric] = (num - once_counts[metric][0]) / (den - once_counts[metric][1])
+
+    params = dict((k, v) for k, v in vars(a).items() if v is not None and k not in ('name', 'dir'))
+    os.makedirs(a.dir, exist_ok=True)
+    with open(os.path.join(a.dir, name + '.s'), 'w') as f:
+        f.write('\n'.join(prologue(name, params) + body + epilogue() + data) + '\n')
+    with open(os.path.join(a.dir, name + '.once.s'), 'w') as f:
+        f.write('\n'.join(prologue(name + '.once', params) + once_body + epilogue() + data) + '\n')
+    with open(os.path.join(a.dir, name + '.json'), 'w') as f:
+        json.dump({'name': name, 'parameters': params, 'cache': [rows, line_bytes],
+                   'kernel instructions': instructions, 'expected': expected},
+                  f, indent=1, sort_keys=True)
+    print('%-18s %s' % (name, ', '.join('%s %.4f' % kv for kv in sorted(expected.items()))))
+
+
+def simulate(program):
+    """Counters of one run and its wall time."""
+    start = time.perf_counter()
+    proc = subprocess.run([bench.SIMULATOR, '--load=%s' % program],
+                          stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    wall = time.perf_counter() - start
+    return bench.parse_stats(proc.stdout.decode('latin-1')), wall
+
+
+def measure(stats, metric):
+    num, den = METRICS[metric]
+    d = sum(stats.get(k, 0.0) for k in den)
+    return sum(stats.get(k, 0.0) for k in num) / d if d else float('nan')
+
+
+def check(args):
+    specs = sorted(glob.glob(os.path.join(args.dir, '*.json')))
+    if args.only:
+        wanted = set(args.only.split(','))
+        specs = [s for s in specs if os.path.basename(s)[:-5] in wanted]
+    if not specs:
+        sys.exit('no kernels in %s, run ./synth.py suite (or make synth) first' % args.dir)
+
+    geometry = list(read_geometry())
+    failures = 0
+    print('%-18s %-24s %10s %10s %8s %8s' % ('kernel', 'metric', 'expected', 'measured', '', 'MIPS'))
+    for spec in specs:
+        with open(spec) as f:
+            s = json.load(f)
+        if s['cache'] != geometry:
+            print('%-18s generated for another cache geometry, regenerate it' % s['name'])
+            failures += 1
+            continue
+
+        stats, wall = simulate('%s.mips' % spec[:-5])
+        once, _ = simulate('%s.once.mips' % spec[:-5])
+        if 'instructionCount' not in stats or 'instructionCount' not in once:
+            print('%-18s no instructionCount in the simulator output' % s['name'])
+            failures += 1
+            continue
+
+        mips = stats['instructionCount'] / wall / 1e6
+        kernel = dict((k, v - once.get(k, 0.0)) for k, v in stats.items())
+        for i, (metric, want) in enumerate(sorted(s['expected'].items())):
+            got = measure(kernel, metric)
+            ok = abs(got - want) <= REL_TOLERANCE * want
+            failures += not ok
+            print('%-18s %-24s %10.4f %10.4f %8s %8s' % (s['name'] if i == 0 else '', metric, want, got,
+                                                         'ok' if ok else 'FAIL', '%.2f' % mips if i == 0 else ''))
+
+    if failures:
+        print('%d failure(s)' % failures)
+        return 1
+    return 0
+
+
+def main():
+    if len(sys.argv) > 1 and sys.argv[1] == 'gen':
+        generate(sys.argv[2:])
+        return 0
+
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('command', choices=['suite', 'check', 'gen'])
+    parser.add_argument('--dir', default=SYNTH_DIR)
+    parser.add_argument('--only', help='comma separated kernels (default all)')
+    args = parser.parse_args()
+
+    if args.command == 'suite':
+        for name in sorted(SUITE):
+            if not args.only or name in args.only.split(','):
+                generate(SUITE[name] + ['--dir', args.dir], name)
+        return 0
+    return check(args)
+
+
+if __name__ == '__main__':
+    sys.exit(main())